@@ -0,0 +1,56 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+#include "alignedallocator.hpp"
+#include "particlestore.hpp"
+#include "windfield.hpp"
+#include "jobsystem.hpp"
+
+// Rows of quads per tile of triangles
+constexpr uint32_t AERO_TILE_ROWS = 4;
+// Triangles whose wind is looked up together
+constexpr size_t AERO_SAMPLE_BATCH = 64;
+
+// Air pushing on the cloth's triangles. Each triangle sees the wind at its
+// centroid relative to its own velocity, v, and its unit normal n, turned to
+// face downwind. With A its rest area:
+//   drag     drag * A * (v.n) * v                  along the flow
+//   lift     lift * A * (v.n) * (|v| n - (v.n) v/|v|) across it
+//   friction friction * A * |vt| * vt              along the surface
+// where vt is the part of v along the surface. A third of each goes to each
+// corner. The coefficients fold in the air density and the cloth's areal
+// mass, which the unit particle masses don't model.
+//
+// The triangles are laid out a row of quads at a time, like the cloth mesh.
+// Tiles of AERO_TILE_ROWS rows only share corners with the tiles either side,
+// so the even tiles scatter in parallel, then the odd ones.
+class Aerodynamics {
+public:
+    float drag;
+    float lift;
+    float friction;
+
+    Aerodynamics();
+
+    // Takes the triangles and their rest areas; rowTriangles is the number
+    // of triangles in each row of quads
+    void build(const ParticleStore& particles, const std::vector<unsigned int>& indices, size_t rowTriangles);
+
+    // Per-particle normals to orient the triangles by; kept by pointer and
+    // only read while the force tasks run
+    void setNormals(const glm::vec3* vertexNormals) { normals = vertexNormals; }
+
+    // Adds the forces for a step of length dt. Particles without inverse
+    // mass get none.
+    TaskGraph::TaskId addForceTasks(TaskGraph& graph, ParticleStore& particles, const WindField& wind, float dt, TaskGraph::TaskId after);
+
+private:
+    std::vector<uint32_t> triangles;
+    AlignedVector<float> areas;
+    size_t tileTriangles;
+    size_t tileCount;
+    const glm::vec3* normals;
+
+    void applyTile(ParticleStore& particles, const WindField& wind, float dt, size_t tile) const;
+};
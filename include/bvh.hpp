@@ -0,0 +1,217 @@
+#pragma once
+#include <bit>
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+// Leaves hold at most this many items
+constexpr uint32_t BVH_LEAF_SIZE = 4;
+
+// Bounding volume hierarchy over axis-aligned boxes, one per item. Nodes are
+// laid out depth first: the left child directly follows its parent, so a
+// parent always comes before its children and refitting after the items
+// move is one backwards pass with no rebuild.
+class Bvh {
+public:
+    struct Node {
+        glm::vec3 lo;
+        uint32_t rightOrFirst; // right child for interior nodes, first item for leaves
+        glm::vec3 hi;
+        uint32_t count;        // 0 for interior nodes
+    };
+
+    void build(const glm::vec3* itemLo, const glm::vec3* itemHi, size_t count);
+
+    // Item bounds changed but not the set of items
+    void refit(const glm::vec3* itemLo, const glm::vec3* itemHi);
+
+    void clear();
+    bool empty() const { return nodes.empty(); }
+
+    // Calls fn(item) for every item whose box contains the point
+    template<typename Function>
+    void forEachContaining(const glm::vec3& p, Function&& fn) const;
+
+    // Calls fn(item) for every item whose box overlaps [lo, hi]
+    template<typename Function>
+    void forEachOverlapping(const glm::vec3& lo, const glm::vec3& hi, Function&& fn) const;
+
+    // Nearest item search. fn(item) returns the squared distance from p to
+    // the item itself; nearer subtrees are visited first and any subtree
+    // whose box is no closer than the best so far is skipped. Returns the
+    // nearest item within sqrt(maxDistanceSq), or -1.
+    template<typename Function>
+    int64_t findNearest(const glm::vec3& p, float maxDistanceSq, Function&& distanceSq) const;
+
+    // findNearest for a batch of points sharing one traversal, which pays
+    // off when they lie close together. bestSq holds each point's search
+    // radius squared and gets its nearest item's squared distance; best gets
+    // the item, or -1. fn(point, item) returns the squared distance between
+    // them. Takes at most 64 points. A node is opened once for the whole
+    // batch if any point could still find something nearer in it.
+    template<typename Function>
+    void findNearestBatch(const glm::vec3* points, uint32_t count, float* bestSq, int64_t* best, Function&& distanceSq) const;
+
+private:
+    std::vector<Node> nodes;
+    // Item indices, grouped so each leaf owns a contiguous run, and a copy
+    // of their bounds in the same order so leaves can cull item by item
+    std::vector<uint32_t> items;
+    std::vector<glm::vec3> leafLo;
+    std::vector<glm::vec3> leafHi;
+
+    static float distanceSq(const glm::vec3& p, const glm::vec3& lo, const glm::vec3& hi) {
+        glm::vec3 d = glm::max(glm::max(lo - p, p - hi), glm::vec3(0.0f));
+        return glm::dot(d, d);
+    }
+
+    static bool overlaps(const glm::vec3& aLo, const glm::vec3& aHi, const glm::vec3& bLo, const glm::vec3& bHi) {
+        return aHi.x >= bLo.x && aLo.x <= bHi.x &&
+               aHi.y >= bLo.y && aLo.y <= bHi.y &&
+               aHi.z >= bLo.z && aLo.z <= bHi.z;
+    }
+
+    uint32_t buildNode(const glm::vec3* itemLo, const glm::vec3* itemHi, uint32_t first, uint32_t count);
+};
+
+template<typename Function>
+void Bvh::forEachOverlapping(const glm::vec3& lo, const glm::vec3& hi, Function&& fn) const {
+    if (nodes.empty()) return;
+
+    uint32_t stack[64];
+    int top = 0;
+    stack[top++] = 0;
+
+    while (top > 0) {
+        const Node& node = nodes[stack[--top]];
+
+        if (!overlaps(lo, hi, node.lo, node.hi)) continue;
+
+        if (node.count > 0) {
+            for (uint32_t k = node.rightOrFirst; k < node.rightOrFirst + node.count; ++k) {
+                if (overlaps(lo, hi, leafLo[k], leafHi[k])) {
+                    fn(items[k]);
+                }
+            }
+        }
+        else {
+            uint32_t index = static_cast<uint32_t>(&node - nodes.data());
+            stack[top++] = node.rightOrFirst;
+            stack[top++] = index + 1;
+        }
+    }
+}
+
+template<typename Function>
+void Bvh::forEachContaining(const glm::vec3& p, Function&& fn) const {
+    forEachOverlapping(p, p, fn);
+}
+
+template<typename Function>
+int64_t Bvh::findNearest(const glm::vec3& p, float maxDistanceSq, Function&& itemDistanceSq) const {
+    int64_t best = -1;
+    if (nodes.empty()) return best;
+
+    float bestSq = maxDistanceSq;
+    uint32_t stack[64];
+    int top = 0;
+    stack[top++] = 0;
+
+    while (top > 0) {
+        const Node& node = nodes[stack[--top]];
+        if (distanceSq(p, node.lo, node.hi) >= bestSq) continue;
+
+        if (node.count > 0) {
+            for (uint32_t k = node.rightOrFirst; k < node.rightOrFirst + node.count; ++k) {
+                if (distanceSq(p, leafLo[k], leafHi[k]) >= bestSq) continue;
+
+                float d = itemDistanceSq(items[k]);
+                if (d < bestSq) {
+                    bestSq = d;
+                    best = items[k];
+                }
+            }
+        }
+        else {
+            // Push the farther child first so the nearer one is popped next
+            uint32_t left = static_cast<uint32_t>(&node - nodes.data()) + 1;
+            uint32_t right = node.rightOrFirst;
+            float leftSq = distanceSq(p, nodes[left].lo, nodes[left].hi);
+            float rightSq = distanceSq(p, nodes[right].lo, nodes[right].hi);
+            if (leftSq < rightSq) {
+                stack[top++] = right;
+                stack[top++] = left;
+            }
+            else {
+                stack[top++] = left;
+                stack[top++] = right;
+            }
+        }
+    }
+    return best;
+}
+
+template<typename Function>
+void Bvh::findNearestBatch(const glm::vec3* points, uint32_t count, float* bestSq, int64_t* best, Function&& itemDistanceSq) const {
+    for (uint32_t j = 0; j < count; ++j) {
+        best[j] = -1;
+    }
+    if (nodes.empty() || count == 0) return;
+
+    // Children are visited nearest the middle of the batch first
+    glm::vec3 lo = points[0];
+    glm::vec3 hi = points[0];
+    for (uint32_t j = 1; j < count; ++j) {
+        lo = glm::min(lo, points[j]);
+        hi = glm::max(hi, points[j]);
+    }
+    const glm::vec3 middle = (lo + hi) * 0.5f;
+
+    // Each entry carries the points its parent could still use, so points
+    // that left a subtree are not tested again further down it
+    uint32_t stack[64];
+    uint64_t live[64];
+    int top = 0;
+    stack[top] = 0;
+    live[top++] = count == 64 ? ~uint64_t(0) : (uint64_t(1) << count) - 1;
+
+    while (top > 0) {
+        --top;
+        const Node& node = nodes[stack[top]];
+
+        uint64_t mask = 0;
+        for (uint64_t bits = live[top]; bits; bits &= bits - 1) {
+            uint32_t j = static_cast<uint32_t>(std::countr_zero(bits));
+            if (distanceSq(points[j], node.lo, node.hi) < bestSq[j]) {
+                mask |= uint64_t(1) << j;
+            }
+        }
+        if (!mask) continue;
+
+        if (node.count > 0) {
+            for (uint32_t k = node.rightOrFirst; k < node.rightOrFirst + node.count; ++k) {
+                for (uint64_t bits = mask; bits; bits &= bits - 1) {
+                    uint32_t j = static_cast<uint32_t>(std::countr_zero(bits));
+                    if (distanceSq(points[j], leafLo[k], leafHi[k]) >= bestSq[j]) continue;
+
+                    float d = itemDistanceSq(j, items[k]);
+                    if (d < bestSq[j]) {
+                        bestSq[j] = d;
+                        best[j] = items[k];
+                    }
+                }
+            }
+        }
+        else {
+            uint32_t left = static_cast<uint32_t>(&node - nodes.data()) + 1;
+            uint32_t right = node.rightOrFirst;
+            float leftSq = distanceSq(middle, nodes[left].lo, nodes[left].hi);
+            float rightSq = distanceSq(middle, nodes[right].lo, nodes[right].hi);
+            uint32_t near = leftSq < rightSq ? left : right;
+            stack[top] = near == left ? right : left;
+            live[top++] = mask;
+            stack[top] = near;
+            live[top++] = mask;
+        }
+    }
+}
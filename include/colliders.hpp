@@ -0,0 +1,107 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+#include "alignedallocator.hpp"
+#include "particlestore.hpp"
+#include "bvh.hpp"
+#include "meshcollider.hpp"
+#include "sdfcollider.hpp"
+
+enum class COLLIDERTYPE : uint8_t {
+    SPHERE,
+    BOX,
+    CAPSULE,
+    PLANE,
+    MESH,
+    SDF,
+    LAST
+};
+
+// Static and kinematic shapes the cloth collides with, stored structure of
+// arrays. Every shape is described by a signed distance to its surface; a
+// particle is in contact once it comes within the shape's margin and is put
+// back on the surface. Bounded shapes sit in a BVH so each particle only
+// looks at the ones whose bounds it is inside. Planes have no bounds and are
+// tested by every particle.
+class ColliderSet {
+public:
+    void clear();
+
+    uint32_t addSphere(const glm::vec3& center, float radius, float margin = 0.0f);
+    uint32_t addBox(const glm::vec3& center, const glm::vec3& halfExtents, float margin = 0.0f);
+    // Segment from a to b, swept by the radius
+    uint32_t addCapsule(const glm::vec3& a, const glm::vec3& b, float radius, float margin = 0.0f);
+    // Everything behind the plane is solid
+    uint32_t addPlane(const glm::vec3& point, const glm::vec3& normal, float margin = 0.0f);
+    // Mesh placed with its local origin at `origin`, its surface grown by
+    // the thickness. The set keeps a pointer; the mesh has to outlive it.
+    uint32_t addMesh(const MeshCollider& mesh, const glm::vec3& origin, float thickness, float margin = 0.0f);
+    // Baked distance field, placed and kept the same way as a mesh. Only
+    // particles inside the baked grid can touch it.
+    uint32_t addSdf(const SdfCollider& sdf, const glm::vec3& origin, float thickness, float margin = 0.0f);
+
+    // Moves a collider; the BVH is refit on the next update
+    void setCenter(uint32_t id, const glm::vec3& center);
+
+    // Builds the BVH after colliders were added, or refits it after they
+    // moved. Call between steps, never while collide() may be running.
+    void update();
+
+    // Pushes particles in [begin, end) out of every collider they touch and
+    // applies the washcloth friction. Safe to run on disjoint ranges in
+    // parallel.
+    void collide(ParticleStore& particles, size_t begin, size_t end) const;
+
+    // Continuous pass, run right after integration while prevPositions still
+    // holds where each particle started the step. A particle whose path
+    // reaches a collider surface is stopped at the first time of impact and
+    // keeps only the part of the rest of its move that slides along the
+    // surface, so fast particles can't tunnel between two discrete checks.
+    void sweep(ParticleStore& particles, size_t begin, size_t end) const;
+
+    size_t size() const { return types.size(); }
+    bool empty() const { return types.empty(); }
+
+private:
+    std::vector<COLLIDERTYPE> types;
+    AlignedVector<glm::vec3> centers;     // sphere, box and capsule center; a point on a plane; mesh or SDF origin
+    AlignedVector<glm::vec3> halfExtents; // boxes only
+    AlignedVector<glm::vec3> axes;        // capsule half segment; plane normal
+    AlignedVector<float> radii;           // spheres and capsules; mesh and SDF thickness
+    std::vector<const MeshCollider*> meshes;
+    std::vector<const SdfCollider*> sdfs;
+    AlignedVector<float> margins;
+
+    // Bounded colliders, with their bounds grown by the margin. The BVH
+    // indexes into these.
+    std::vector<uint32_t> bounded;
+    AlignedVector<glm::vec3> boundsLo;
+    AlignedVector<glm::vec3> boundsHi;
+    std::vector<uint32_t> planes;
+
+    Bvh bvh;
+    bool structureDirty = false;
+    bool boundsDirty = false;
+
+    uint32_t push(COLLIDERTYPE type, const glm::vec3& center, float margin);
+    void computeBounds(size_t item);
+    // Distance from the collider's center offset `diff`, for a known type
+    template <COLLIDERTYPE Type>
+    float shapeDistance(uint32_t id, const glm::vec3& diff, glm::vec3& normal) const;
+    float signedDistance(uint32_t id, const glm::vec3& p, glm::vec3& normal) const;
+    // Signed distance of a mesh collider from its closest triangle point
+    float meshDistance(uint32_t id, const glm::vec3& diff, const glm::vec3& closest, const glm::vec3& faceNormal, glm::vec3& normal) const;
+    // collide() for a set holding one collider of the given type
+    template <COLLIDERTYPE Type>
+    void collideSingle(ParticleStore& particles, size_t begin, size_t end) const;
+    // collideSingle for a mesh, with the particles' queries batched
+    void collideMesh(ParticleStore& particles, size_t begin, size_t end) const;
+    void collideWith(uint32_t id, ParticleStore& particles, size_t i) const;
+    // Never more than the distance to the contact surface, even where
+    // signedDistance can't say
+    float sweepDistance(uint32_t id, const glm::vec3& p) const;
+    // Fraction of the move from `from` along `delta` at which the contact
+    // surface is reached; above 1 for no impact
+    float timeOfImpact(uint32_t id, const glm::vec3& from, const glm::vec3& delta, float length) const;
+};
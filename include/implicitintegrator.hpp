@@ -0,0 +1,101 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+#include "alignedallocator.hpp"
+#include "particlestore.hpp"
+#include "springs.hpp"
+#include "jobsystem.hpp"
+
+// Particles or springs per chunk in the implicit solver's passes
+constexpr size_t IMPLICIT_GRAIN = 1024;
+
+// Backward Euler for the spring forces, linearised once per step in the
+// style of Baraff and Witkin:
+//   (M - h df/dv - h^2 df/dx) dv = h (f + h df/dx v)
+// The system is never assembled. Each spring keeps its own 3x3 blocks and
+// the matrix is applied particle by particle through the spring lists, so
+// every pass gathers and none of them race. Conjugate gradient with a block
+// Jacobi preconditioner solves it, starting from the previous step's dv.
+// Velocities are kept Verlet style, as the last step's displacement, so the
+// rest of the pipeline doesn't notice which integrator ran.
+class ImplicitIntegrator {
+public:
+    int maxIterations;
+    // Stop once the residual is this fraction of the right hand side
+    float tolerance;
+
+    ImplicitIntegrator();
+
+    // Builds the solver's passes for a step of length dt. Without springs
+    // only the external forces and gravity are integrated. The passes
+    // capture the particle count and spring ranges, so this has to be
+    // redone whenever the step graph is.
+    void prepare(ParticleStore& particles, const SpringBuffer* springs, float dt);
+
+    // One step: forces and Jacobians, the solve, then the new positions.
+    // Clears the accumulated forces like ParticleStore::updateVerlet.
+    void step(JobSystem& jobs, const glm::vec3& gravity);
+
+    // Positions at the start of the last step, for drawing between steps.
+    // prepare() sets them to the current positions. Unlike prevPositions,
+    // the collision passes never rewrite them.
+    const AlignedVector<glm::vec3>& getStartPositions() const { return startPositions; }
+
+    int getIterations() const { return iterations; }
+    float getResidual() const { return residual; }
+
+private:
+    // A spring's force on its first particle and its share of the system
+    // matrix: stiffness is h^2 times the positive part of -df/dx, damping
+    // is h^2 times the coefficient along the spring
+    struct SpringBlock {
+        glm::mat3 stiffness;
+        glm::vec3 direction;
+        float damping;
+        glm::vec3 force;
+    };
+
+    // Dot products of one chunk, padded so chunks don't share cache lines
+    struct alignas(64) Partial {
+        float first;
+        float second;
+        float third;
+    };
+
+    ParticleStore* particles;
+    const SpringBuffer* springs;
+    float dt;
+    glm::vec3 gravity;
+
+    AlignedVector<SpringBlock> blocks;
+    AlignedVector<glm::vec3> velocities;
+    AlignedVector<glm::vec3> startPositions;
+    AlignedVector<glm::vec3> rhs;
+    AlignedVector<glm::vec3> deltaV;
+    AlignedVector<glm::vec3> residuals;
+    AlignedVector<glm::vec3> preconditioned;
+    AlignedVector<glm::vec3> directions;
+    AlignedVector<glm::vec3> products;
+    AlignedVector<glm::mat3> inverseDiagonal;
+    std::vector<Partial> partials;
+
+    // Step sizes the passes read between runs
+    float alpha;
+    float beta;
+
+    TaskGraph setupGraph;
+    TaskGraph startGraph;
+    TaskGraph multiplyGraph;
+    TaskGraph updateGraph;
+    TaskGraph directionGraph;
+    TaskGraph finishGraph;
+
+    int iterations;
+    float residual;
+
+    void computeBlocks(size_t begin, size_t end);
+    void assemble(size_t begin, size_t end);
+    void multiply(size_t begin, size_t end);
+    Partial sumPartials() const;
+};
@@ -0,0 +1,95 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+#include "alignedallocator.hpp"
+#include "particlestore.hpp"
+#include "jobsystem.hpp"
+
+// Particles per chunk in the acceleration passes
+constexpr size_t ACCELERATION_GRAIN = 4096;
+// Most past iterations Anderson mixing can combine
+constexpr int MAX_ANDERSON_WINDOW = 8;
+
+enum class ACCELERATION {
+    NONE,
+    CHEBYSHEV, // semi-iterative extrapolation over the last two iterates
+    ANDERSON,  // least squares mix of the last few iterations
+    LAST
+};
+
+// Treats one constraint iteration as a fixed point map x -> g(x) on the
+// particle positions and extrapolates from its history. The positions are
+// kept at the start of every iteration, and right after the sweep the
+// accelerated ones replace what the sweep left, so the collision passes
+// still get the last word.
+//
+// Chebyshev (Wang 2015): q(k+1) = w(k+1) (g(q(k)) - q(k-1)) + q(k-1), with
+// w growing towards 2 / (1 + sqrt(1 - rho^2)) for an estimated spectral
+// radius rho, after `delay` plain iterations.
+//
+// Anderson (type II): with f = g(x) - x and the differences of the last
+// `window` f and g, x(k+1) = g(x(k)) - dG c, where c minimises
+// |f(k) - dF c|. The history is dropped whenever |f| grows.
+class IterationAccelerator {
+public:
+    ACCELERATION mode;
+    float spectralRadius;
+    // Blends each sweep with where it started; below 1 damps oscillation
+    float underRelaxation;
+    int delay;
+    int window;
+
+    IterationAccelerator();
+
+    bool enabled() const { return mode != ACCELERATION::NONE; }
+
+    // Sizes the buffers; call whenever the tasks are rebuilt
+    void prepare(size_t count);
+
+    // Serial, between graph runs: before a step's first iteration, and
+    // before each iteration
+    void begin();
+    void next();
+
+    // Keeps the positions at the start of the iteration. Goes before the sweep.
+    TaskGraph::TaskId addStartTasks(TaskGraph& graph, ParticleStore& particles, TaskGraph::TaskId after);
+
+    // Replaces the sweep's result with the accelerated one. Goes right after it.
+    TaskGraph::TaskId addTasks(TaskGraph& graph, ParticleStore& particles, TaskGraph::TaskId after);
+
+    float getOmega() const { return omega; }
+    int getHistory() const { return history; }
+
+private:
+    // Sums of one chunk, padded so chunks don't share cache lines
+    struct alignas(64) Partial {
+        std::array<double, MAX_ANDERSON_WINDOW * MAX_ANDERSON_WINDOW> gram;
+        std::array<double, MAX_ANDERSON_WINDOW> projected;
+        double residualSq;
+    };
+
+    size_t count;
+    // Start of this iteration and of the one before; swapped by next()
+    AlignedVector<glm::vec3> starts[2];
+    int current;
+    int iteration;
+    float omega;
+
+    // Anderson history: the last f and g, then rings of their differences
+    AlignedVector<glm::vec3> lastResidual;
+    AlignedVector<glm::vec3> lastResult;
+    std::array<AlignedVector<glm::vec3>, MAX_ANDERSON_WINDOW> residualDifferences;
+    std::array<AlignedVector<glm::vec3>, MAX_ANDERSON_WINDOW> resultDifferences;
+    std::vector<Partial> partials;
+    std::array<float, MAX_ANDERSON_WINDOW> coefficients;
+    int history;
+    int newest;
+    double previousResidualSq;
+
+    void chebyshev(ParticleStore& particles, size_t begin, size_t end) const;
+    void differences(ParticleStore& particles, size_t begin, size_t end);
+    void solveCoefficients();
+    void mix(ParticleStore& particles, size_t begin, size_t end) const;
+};
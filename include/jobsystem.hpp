@@ -0,0 +1,112 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// A set of tasks with dependencies. Each task is a range [0, count) that the
+// job system splits into chunks of `grain` and spreads across its workers; a
+// task becomes ready once every task it depends on has finished all of its
+// chunks. A graph can be submitted again once the previous run has finished.
+class TaskGraph {
+public:
+    using TaskId = uint32_t;
+    using TaskFunction = std::function<void()>;
+    using RangeFunction = std::function<void(size_t begin, size_t end)>;
+
+    static constexpr TaskId NONE = UINT32_MAX;
+
+    TaskId add(TaskFunction fn);
+    TaskId addParallelFor(size_t count, size_t grain, RangeFunction fn);
+
+    // `after` only starts once `before` is done. NONE is ignored.
+    void precede(TaskId before, TaskId after);
+
+    void clear();
+    bool empty() const { return nodes.empty(); }
+    bool isDone() const { return pendingNodes.load(std::memory_order_acquire) == 0; }
+
+private:
+    friend class JobSystem;
+
+    struct Node {
+        RangeFunction fn;
+        size_t count = 0;
+        size_t grain = 1;
+        size_t chunks = 0;
+        std::vector<TaskId> successors;
+        uint32_t dependencies = 0;
+        std::atomic<uint32_t> pendingDependencies{ 0 };
+        std::atomic<size_t> pendingChunks{ 0 };
+    };
+
+    // deque keeps node addresses stable while the graph grows
+    std::deque<Node> nodes;
+    std::atomic<size_t> pendingNodes{ 0 };
+};
+
+// Work-stealing thread pool. Every worker owns a queue it pushes to and pops
+// from the back of; idle workers steal from the front of other queues.
+// Threads that aren't workers submit through a shared injection queue, and
+// help run jobs while they wait, so nested parallelFor calls never deadlock.
+class JobSystem {
+public:
+    using RangeFunction = TaskGraph::RangeFunction;
+
+    // A worker count of 0 uses one worker per hardware thread, minus the caller.
+    // Pinned workers are bound to cores 1..N, leaving core 0 to the main thread.
+    explicit JobSystem(unsigned workerCount = 0, bool pinThreads = false);
+    ~JobSystem();
+
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    // Starts the graph and returns immediately
+    void submit(TaskGraph& graph);
+
+    // Runs queued jobs on the calling thread until the graph has finished
+    void wait(TaskGraph& graph);
+
+    void run(TaskGraph& graph);
+
+    void parallelFor(size_t count, size_t grain, const RangeFunction& fn);
+
+    unsigned getWorkerCount() const { return static_cast<unsigned>(workers.size()); }
+    bool arePinned() const { return pinned; }
+
+private:
+    struct Job {
+        TaskGraph* graph;
+        TaskGraph::TaskId node;
+        size_t chunk;
+    };
+
+    struct WorkQueue {
+        std::mutex mutex;
+        std::deque<Job> jobs;
+    };
+
+    std::vector<std::thread> workers;
+    // One queue per worker, followed by the injection queue
+    std::vector<std::unique_ptr<WorkQueue>> queues;
+    std::mutex sleepMutex;
+    std::condition_variable sleepCondition;
+    std::atomic<size_t> queuedJobs;
+    std::atomic<unsigned> stealCursor;
+    bool stopping;
+    bool pinned;
+
+    void workerLoop(unsigned index);
+    int currentQueue() const;
+    bool tryPop(Job& job);
+    void execute(const Job& job);
+    void scheduleNode(TaskGraph& graph, TaskGraph::TaskId id);
+    void completeNode(TaskGraph& graph, TaskGraph::TaskId id);
+    void wakeAll();
+};
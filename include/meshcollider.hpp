@@ -0,0 +1,66 @@
+#pragma once
+#include <cstdint>
+#include <span>
+#include <vector>
+#include <glm/glm.hpp>
+#include "alignedallocator.hpp"
+#include "meshgenerator.hpp"
+#include "bvh.hpp"
+
+// Points per batch of closest point queries
+constexpr uint32_t MESH_QUERY_BATCH = 16;
+
+// Triangle mesh the cloth can collide with, in the collider's local space.
+// The BVH is built once; when the vertices move it is refit instead. Each
+// triangle keeps its corner, edges and face normal next to each other so
+// closest point queries touch one array per triangle.
+class MeshCollider {
+public:
+    // Every three vertices form a triangle, as MeshGenerator emits them.
+    // Triangles are turned to face the way the vertex normals point.
+    void build(const std::vector<PoleVertex>& triangles, const glm::vec3& scale = glm::vec3(1.0f));
+
+    // Indexed triangles, counter-clockwise seen from outside
+    void build(std::span<const glm::vec3> vertices, std::span<const uint32_t> indices);
+
+    // Same triangles, new vertex positions; refits the BVH. A ColliderSet
+    // holding the mesh needs setCenter afterwards to pick up the new bounds.
+    void updateVertices(std::span<const glm::vec3> vertices);
+
+    // Closest point on any triangle within maxDistance of p, and that
+    // triangle's face normal. False when nothing is that close.
+    bool closestPoint(const glm::vec3& p, float maxDistance, glm::vec3& closest, glm::vec3& normal) const;
+
+    // closestPoint for up to MESH_QUERY_BATCH points at once, with one walk
+    // of the BVH; neighbouring particles of the cloth share most of theirs.
+    // found[j] says whether points[j] got a closest point and normal.
+    void closestPoints(const glm::vec3* points, uint32_t count, float maxDistance, glm::vec3* closest, glm::vec3* normals, bool* found) const;
+
+    // FNV-1a over the vertices and triangles, to tell whether something
+    // derived from the mesh is still current
+    uint64_t contentHash() const;
+
+    const glm::vec3& getBoundsMin() const { return boundsMin; }
+    const glm::vec3& getBoundsMax() const { return boundsMax; }
+    size_t triangleCount() const { return indices.size() / 3; }
+    bool empty() const { return indices.empty(); }
+
+private:
+    struct Triangle {
+        glm::vec3 a;
+        glm::vec3 ab;
+        glm::vec3 ac;
+        glm::vec3 normal;
+    };
+
+    std::vector<glm::vec3> vertices;
+    std::vector<uint32_t> indices;
+    AlignedVector<Triangle> triangles;
+    std::vector<glm::vec3> triangleMin;
+    std::vector<glm::vec3> triangleMax;
+    glm::vec3 boundsMin{ 0.0f };
+    glm::vec3 boundsMax{ 0.0f };
+    Bvh bvh;
+
+    void updateTriangles();
+};
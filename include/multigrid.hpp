@@ -0,0 +1,81 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+#include <glm/glm.hpp>
+#include "alignedallocator.hpp"
+#include "particlestore.hpp"
+#include "springs.hpp"
+#include "jobsystem.hpp"
+
+// Particles per chunk when moving positions between levels
+constexpr size_t MULTIGRID_GRAIN = 1024;
+// Levels stop once a side would drop below this many particles
+constexpr uint32_t MULTIGRID_MIN_SIDE = 5;
+
+// Coarse copies of the rows x cols cloth for the constraint sweeps: each
+// level keeps every other row and column of the one above (plus the last
+// ones, so corners and edges survive) and has its own structural, shear and
+// bend springs between them, at rest lengths taken from the rest pose. A
+// V-cycle sweeps the cloth, injects the positions into the next level down,
+// sweeps there, recurses, and then interpolates the level's movement back up
+// bilinearly before sweeping again. Corrections a fine sweep would move one
+// spring per sweep cross the whole cloth in a few levels.
+class Multigrid {
+public:
+    // Sweeps per level on the way down and again on the way up
+    int smoothingSweeps;
+    // Sweeps on the coarsest level
+    int coarsestSweeps;
+
+    Multigrid();
+
+    // Builds up to maxLevels coarse levels for a row-major rows x cols grid.
+    // The fine springs have to be colored and none of them torn.
+    void build(const ParticleStore& particles, const SpringBuffer& springs, uint32_t rows, uint32_t cols, int maxLevels);
+
+    // Tears the coarse springs that span a torn fine spring. The coarse live
+    // ranges change like the fine ones, so rebuild graphs afterwards.
+    void tear(const SpringBuffer& fine);
+
+    void activateAll();
+
+    size_t levelCount() const { return levels.size(); }
+
+    // Adds one sweep of the fine solver after `after`, returns the last task
+    using SweepFunction = std::function<TaskGraph::TaskId(TaskGraph&, TaskGraph::TaskId)>;
+
+    // One V-cycle over the fine particles, whose sweeps come from fineSweep.
+    // The coarse levels always project with the colored clamp.
+    TaskGraph::TaskId addCycleTasks(TaskGraph& graph, ParticleStore& fine, const SweepFunction& fineSweep, TaskGraph::TaskId after);
+
+private:
+    struct Level {
+        uint32_t rows;
+        uint32_t cols;
+        uint32_t finerCols;
+        // Particle of the finer level each of this level's came from
+        std::vector<uint32_t> finerIndex;
+        // For every finer row and column: the line of this level at or
+        // before it, and how far it is towards the next one
+        std::vector<uint32_t> rowBelow;
+        std::vector<float> rowWeight;
+        std::vector<uint32_t> columnBelow;
+        std::vector<float> columnWeight;
+        ParticleStore particles;
+        SpringBuffer springs;
+        // Positions as injected, so the sweeps' movement can be sent back
+        AlignedVector<glm::vec3> injected;
+        // Live springs per particle while nothing was torn
+        std::vector<uint32_t> intactSprings;
+    };
+    // Levels move as a whole when one is added, so they're held by pointer
+    std::vector<std::unique_ptr<Level>> levels;
+    std::vector<uint32_t> fineIntactSprings;
+
+    static void coarseLines(uint32_t count, std::vector<uint32_t>& lines);
+    TaskGraph::TaskId addLevelTasks(TaskGraph& graph, size_t index, ParticleStore& finer, TaskGraph::TaskId after);
+    void restrictLevel(Level& level, const ParticleStore& finer, size_t begin, size_t end);
+    void prolongLevel(const Level& level, ParticleStore& finer, size_t begin, size_t end) const;
+};
@@ -0,0 +1,40 @@
+#pragma once
+#include <cstdint>
+#include <glm/glm.hpp>
+#include "alignedallocator.hpp"
+
+// Structure-of-arrays particle storage. Each attribute lives in its own
+// cache-line aligned array so passes that only need positions don't pull in
+// the rest of the particle. A particle is pinned when its inverse mass is 0.
+class ParticleStore {
+public:
+    AlignedVector<glm::vec3> positions;
+    AlignedVector<glm::vec3> prevPositions;
+    AlignedVector<glm::vec3> forces;
+    AlignedVector<float> invMass;
+    // Where each particle was added; only distances between them matter
+    AlignedVector<glm::vec3> restPositions;
+
+    void clear();
+
+    void reserve(size_t count);
+
+    uint32_t add(const glm::vec3& startPos, float m = 1.0f);
+
+    size_t size() const { return positions.size(); }
+
+    bool empty() const { return positions.empty(); }
+
+    void addForce(size_t i, const glm::vec3& force) { forces[i] += force; }
+
+    bool isPinned(size_t i) const { return invMass[i] == 0.0f; }
+
+    void pin(size_t i);
+
+    void unpin(size_t i, float m = 1.0f);
+
+    void pinTo(size_t i, const glm::vec3& pos);
+
+    void updateVerlet(float dt, const glm::vec3& gravity);
+    void updateVerlet(float dt, const glm::vec3& gravity, size_t begin, size_t end);
+};
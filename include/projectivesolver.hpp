@@ -0,0 +1,90 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <span>
+#include <vector>
+#include <glm/glm.hpp>
+#include "alignedallocator.hpp"
+#include "particlestore.hpp"
+#include "springs.hpp"
+#include "sparsecholesky.hpp"
+#include "jobsystem.hpp"
+
+// Particles per chunk in the projective solver's particle passes
+constexpr size_t PROJECTIVE_GRAIN = 1024;
+
+// Projective Dynamics for the springs (Bouaziz et al.; Liu et al. for mass
+// springs). Each spring's energy is w/2 |x2 - x1 - d|^2, with d the current
+// direction at rest length and w the inverse of its XPBD compliance. An
+// iteration projects every spring (local step) and then solves
+//   (M / h^2 + L) x = M / h^2 y + J d
+// for all three axes (global step), where y is where the particles would be
+// without their springs. The matrix only depends on the springs, the pinned
+// particles, the step length and the weights, so it's factored once and
+// reused until one of those changes. Pinned particles get identity rows and
+// push their positions into their neighbours' right hand sides. Sleeping
+// particles keep their rows, with their frozen positions as the inertial
+// target, so tiles falling asleep or waking don't refactor.
+class ProjectiveSolver {
+public:
+    ProjectiveSolver();
+
+    // The particles form a rows x cols grid in row-major order, which the
+    // fill reducing order is cut from
+    void init(uint32_t rows, uint32_t cols);
+
+    // The live springs changed; the matrix is refactored before the next step
+    void invalidate() { current = false; }
+
+    // 1 for each particle that's asleep and the inverse masses they had, or
+    // empty when none are. Call before the next step whenever they change.
+    void setSleeping(std::span<const uint8_t> particleAsleep, std::span<const float> savedInvMass);
+
+    // Once per step, after integration: refactors if needed and keeps the
+    // integrated positions as the inertial target y
+    TaskGraph::TaskId addStartTasks(TaskGraph& graph, ParticleStore& particles, const SpringBuffer& springs, float dt, TaskGraph::TaskId after);
+
+    // One local/global iteration. Particles with no inverse mass keep their
+    // positions.
+    TaskGraph::TaskId addIterationTasks(TaskGraph& graph, ParticleStore& particles, const SpringBuffer& springs, TaskGraph::TaskId after);
+
+    size_t factorNonZeros() const { return cholesky.nonZeros(); }
+    int getFactorizations() const { return factorizations; }
+
+private:
+    uint32_t rows;
+    uint32_t cols;
+    std::vector<uint32_t> order;
+
+    // What the current factor was built for
+    bool current;
+    float factoredDt;
+    std::array<float, static_cast<size_t>(SPRINGTYPE::LAST)> factoredWeights;
+    std::vector<uint8_t> pinned;
+    SparseCholesky cholesky;
+    int factorizations;
+
+    // Copies of the sleep state; empty while nothing sleeps
+    std::vector<uint8_t> asleep;
+    std::vector<float> sleepingInvMass;
+
+    std::array<float, static_cast<size_t>(SPRINGTYPE::LAST)> weights;
+    float inertia; // 1 / h^2
+    AlignedVector<glm::vec3> inertial;
+    AlignedVector<glm::vec3> projections;
+    std::array<std::vector<double>, 3> rhs;
+    std::array<std::vector<double>, 3> work;
+
+    // A sleeping particle's inverse mass from before it froze, so the matrix
+    // only sees real pins
+    float inverseMass(const ParticleStore& particles, size_t i) const {
+        return !asleep.empty() && asleep[i] ? sleepingInvMass[i] : particles.invMass[i];
+    }
+
+    bool needsFactor(const ParticleStore& particles, float dt) const;
+    void factor(const ParticleStore& particles, const SpringBuffer& springs, float dt);
+    void buildOrder(size_t count);
+    void dissect(uint32_t x0, uint32_t x1, uint32_t y0, uint32_t y1);
+    void project(const ParticleStore& particles, const SpringBuffer& springs, size_t begin, size_t end);
+    void assemble(const ParticleStore& particles, const SpringBuffer& springs, size_t begin, size_t end);
+};
@@ -0,0 +1,53 @@
+#pragma once
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+#include <glm/glm.hpp>
+#include "alignedallocator.hpp"
+#include "meshcollider.hpp"
+#include "jobsystem.hpp"
+
+// Grid points baked per parallel chunk
+constexpr size_t SDF_BAKE_GRAIN = 4096;
+
+// Signed distance to a mesh, baked onto a regular grid in the mesh's local
+// space along with its gradient. A contact test is then one trilinear lookup
+// however many triangles the mesh had. Bakes can be written to disk and
+// loaded back; a cached bake is only used if it was made from the same mesh
+// with the same settings.
+class SdfCollider {
+public:
+    SdfCollider();
+
+    // Samples the mesh every cellSize, reaching padding past its bounds
+    void bake(const MeshCollider& mesh, float cellSize, float padding, JobSystem& jobs);
+
+    // Loads the bake from path when it matches, otherwise bakes and writes
+    // it there. False if the cache couldn't be written; the bake is usable
+    // either way.
+    bool bakeCached(const MeshCollider& mesh, float cellSize, float padding, const std::filesystem::path& path, JobSystem& jobs);
+
+    bool save(const std::filesystem::path& path) const;
+    bool load(const std::filesystem::path& path, uint64_t expectedKey);
+
+    // Trilinear distance and gradient at p. False outside the grid.
+    bool sample(const glm::vec3& p, float& distance, glm::vec3& gradient) const;
+
+    glm::vec3 getBoundsMin() const { return origin; }
+    glm::vec3 getBoundsMax() const { return origin + glm::vec3(dims - glm::ivec3(1)) * cellSize; }
+    bool empty() const { return distances.empty(); }
+
+private:
+    glm::vec3 origin;
+    glm::ivec3 dims;
+    float cellSize;
+    float invCellSize;
+    // What the bake was made from: mesh content plus settings
+    uint64_t sourceKey;
+    std::vector<float> distances;
+    AlignedVector<glm::vec3> gradients;
+
+    static uint64_t makeKey(const MeshCollider& mesh, float cellSize, float padding);
+    size_t indexOf(int x, int y, int z) const { return (static_cast<size_t>(z) * dims.y + y) * dims.x + x; }
+    void computeGradients(size_t begin, size_t end);
+};
@@ -0,0 +1,62 @@
+#pragma once
+#include <cstdint>
+#include <span>
+#include <vector>
+#include "particlestore.hpp"
+#include "spatialhash.hpp"
+#include "jobsystem.hpp"
+
+// Particles per chunk for the self collision passes
+constexpr size_t SELF_COLLISION_GRAIN = 1024;
+
+// Most neighbours a particle keeps per step; the rest are dropped
+constexpr uint32_t MAX_SELF_COLLISION_NEIGHBORS = 16;
+
+// Particle-particle self collision for the cloth. Once per step the particles
+// are hashed and each one gathers the others within reach; the constraint
+// iterations then reuse those lists. Particles closer than the thickness are
+// pushed apart. Pairs that are within reach at rest are neighbours in the
+// cloth and left to the springs, so only folds ever collide.
+//
+// Sleeping particles are frozen, so they get no lists or corrections of their
+// own. They sit in a hash of their own that is only rebuilt when the sleep
+// state changes; awake particles still collide with them.
+class SelfCollision {
+public:
+    float thickness;
+
+    SelfCollision();
+
+    // 1 for each particle that's asleep, or empty when none are. Call before
+    // adding the tasks, whenever the sleep state changes.
+    void setSleeping(std::span<const uint8_t> particleAsleep);
+
+    // Hash plus neighbour lists, after `after`. Returns the last task.
+    TaskGraph::TaskId addBroadphaseTasks(TaskGraph& graph, const ParticleStore& particles, TaskGraph::TaskId after);
+
+    // One projection pass against the current neighbour lists. Every particle
+    // works out its own correction before any of them move, so the passes
+    // need no coloring and don't depend on the thread count.
+    TaskGraph::TaskId addSolveTasks(TaskGraph& graph, ParticleStore& particles, TaskGraph::TaskId after);
+
+private:
+    SpatialHash grid;
+    SpatialHash restingGrid;
+    bool restingGridCurrent;
+    // Awake and sleeping particle indices; both empty while none sleep
+    std::vector<uint32_t> awake;
+    std::vector<uint32_t> resting;
+    std::vector<uint32_t> neighbors;
+    std::vector<uint8_t> neighborCounts;
+    AlignedVector<glm::vec3> corrections;
+    // Thickness the current lists were built for
+    float listThickness;
+
+    size_t activeCount(const ParticleStore& particles) const { return resting.empty() ? particles.size() : awake.size(); }
+    uint32_t activeParticle(size_t k) const { return resting.empty() ? static_cast<uint32_t>(k) : awake[k]; }
+
+    void prepare(const ParticleStore& particles);
+    void findNeighbors(const ParticleStore& particles, size_t begin, size_t end);
+    void computeCorrections(const ParticleStore& particles, size_t begin, size_t end);
+    void applyCorrections(ParticleStore& particles, size_t begin, size_t end) const;
+};
@@ -11,17 +11,48 @@
 #include <imgui_impl_opengl3.h>
 #include "textureloader.hpp"
 #include "meshgenerator.hpp"
-#include "particle.hpp"
+#include "particlestore.hpp"
 #include "springs.hpp"
+#include "spatialhash.hpp"
+#include "selfcollision.hpp"
+#include "colliders.hpp"
+#include "meshcollider.hpp"
+#include "sdfcollider.hpp"
+#include "sleeptiles.hpp"
+#include "implicitintegrator.hpp"
+#include "projectivesolver.hpp"
+#include "multigrid.hpp"
+#include "iterationaccelerator.hpp"
+#include "windfield.hpp"
+#include "aerodynamics.hpp"
+#include "jobsystem.hpp"
 #include "shaders.hpp"
 #include "camera.hpp"
 
 
 constexpr int WinWidth = 800;
 constexpr int WinHeight = 600;
-constexpr int rows = 75;
-constexpr int cols = 100;
-constexpr float spacing = 0.07091f;
+constexpr int DEFAULT_ROWS = 75;
+constexpr int DEFAULT_COLS = 100;
+constexpr float DEFAULT_SPACING = 0.07091f;
+// Particles along each side of the cloth; 2048 x 2048 is about four million
+constexpr int MIN_CLOTH_SIDE = 4;
+constexpr int MAX_CLOTH_SIDE = 2048;
+constexpr float MIN_CLOTH_SPACING = 0.005f;
+constexpr float MAX_CLOTH_SPACING = 0.5f;
+
+constexpr float FIXED_DT = 1.0f / 60.0f;
+constexpr int CONSTRAINT_ITERATIONS = 15; // default upper bound per step
+constexpr int MAX_IMPLICIT_SCALE = 8; // longest implicit step, in fixed steps
+constexpr size_t PARTICLE_GRAIN = 4096;
+constexpr int MULTIGRID_LEVELS = 6; // at most; small cloths get fewer
+// An iteration that lowers the RMS violation by less than this fraction
+// counts as converged too
+constexpr float RESIDUAL_MIN_PROGRESS = 0.005f;
+
+// Baked collider grids; the padding has to cover the contact thickness
+constexpr float SDF_CELL_SIZE = 0.05f;
+constexpr float SDF_PADDING = 0.3f;
 
 constexpr float k_structural = 200.0f;
 constexpr float k_shear = 120.0f;
@@ -31,6 +62,11 @@ constexpr float structural_damping = 85.0f;
 constexpr float shear_damping = 75.0f;
 constexpr float bend_damping = 65.0f;
 
+// XPBD compliance (inverse stiffness, m/N)
+constexpr float structural_compliance = 1e-6f;
+constexpr float shear_compliance = 1e-5f;
+constexpr float bend_compliance = 1e-3f;
+
 namespace fs = std::filesystem;
 
 enum class SIMMODE {
@@ -52,9 +88,56 @@ enum class PINNINGMODE {
 enum class COLLISIONSHAPE {
 	CUBE,
 	SPHERE,
+	SPHERE_MESH,
+	LAST
+};
+
+enum class SOLVERMODE {
+	GAUSS_SEIDEL,
+	JACOBI,
+	XPBD,
+	PROJECTIVE, // Projective Dynamics, weighted by the XPBD compliances
 	LAST
 };
 
+enum class STEPMODE {
+	ITERATIONS, // one step, then repeated constraint sweeps
+	SUBSTEPS,   // several short steps with one sweep each
+	IMPLICIT,   // backward Euler springs, then the usual iterations
+	LAST
+};
+
+
+// Startup options, filled from the command line
+struct SimulationConfig {
+	unsigned workerCount = 0; // 0 = one per hardware thread
+	bool pinThreads = false;
+	SOLVERMODE solver = SOLVERMODE::GAUSS_SEIDEL;
+	float jacobiRelaxation = 1.5f;
+	// Constraint iterations stop once no spring is off by more than this
+	// fraction of its rest length, or once they stop making progress;
+	// 0 always runs maxIterations
+	float residualTolerance = 1e-3f;
+	int minIterations = 4;
+	int maxIterations = CONSTRAINT_ITERATIONS;
+	// Above 0, each step is cut into this many substeps instead
+	int substeps = 0;
+	// Above 0, springs are integrated implicitly with steps this many
+	// times the fixed step; ignored when substepping
+	int implicitScale = 0;
+	// Let resting tiles of the cloth sleep
+	bool sleeping = true;
+	// Gauss-Seidel and Jacobi iterate in multigrid V-cycles
+	bool multigrid = false;
+	// Extrapolates the constraint iterations of every solver but XPBD
+	ACCELERATION acceleration = ACCELERATION::NONE;
+	// The flag's wind is the same for the same seed
+	uint32_t windSeed = 1;
+	// Particles down and across the cloth, and the gap between them
+	int rows = DEFAULT_ROWS;
+	int cols = DEFAULT_COLS;
+	float spacing = DEFAULT_SPACING;
+};
 
 struct CollisionObject {
 	glm::vec3 position;
@@ -64,17 +147,46 @@ struct CollisionObject {
 
 class Simulation {
 public:
-	Simulation();
+	Simulation(const SimulationConfig& config = SimulationConfig());
 	bool init();
 	void run();
 
 private:
+	// Cloth resolution; changing it rebuilds the cloth through resizeCloth()
+	int rows;
+	int cols;
+	float spacing;
 	SIMMODE currentMode;
 	PINNINGMODE currentPinning;
 	COLLISIONSHAPE currentCollisionShape;
+	SOLVERMODE currentSolver;
+	// Drawn prop for collision mode; the physics uses the collider set
 	CollisionObject collisionObject;
-	std::vector<Particle> particles;
-	std::vector<Spring> springs;
+	ColliderSet colliders;
+	// Sweep each particle's step against the colliders before the discrete checks
+	bool continuousCollision;
+	// The drawn sphere's triangles, as a mesh collider
+	MeshCollider sphereMesh;
+	// The cube is baked to a distance field at startup
+	MeshCollider cubeMesh;
+	SdfCollider cubeSdf;
+	ParticleStore particles;
+	SpringBuffer springs;
+	// Keeps its factorization between steps; told when springs tear
+	ProjectiveSolver projective;
+	// Coarse levels of the cloth, for V-cycles of the clamp solvers
+	Multigrid multigrid;
+	bool multigridEnabled;
+	// Wrapped around the sweeps of the iteration loop
+	IterationAccelerator accelerator;
+	SpatialHash particleGrid;
+	bool particleGridCurrent;
+	SelfCollision selfCollision;
+	// Self collision costs a broadphase per step, so each mode opts in
+	std::array<bool, static_cast<size_t>(SIMMODE::LAST)> selfCollisionModes;
+	std::vector<glm::vec3> renderPositions;
+	// Ends of the live springs, drawn as lines in tear mode
+	std::vector<glm::vec3> springLines;
 	std::vector<PoleVertex> cylinder;
 	std::vector<PoleVertex> cube;
 	std::vector<PoleVertex> sphere;
@@ -114,12 +226,44 @@ private:
 	glm::vec2 mousePos;
 	bool leftMouseDown;
 	float tearRadius;
-	std::vector<bool> springActive;
 	glm::mat4 projectionMatrix;
 	bool isCameraActive;
 	std::array<std::string, 6> tearFaces;
 	std::array<std::string, 6> collisionFaces;
 	std::array<std::string, 6> flagFaces;
+	JobSystem jobs;
+	// A step is stepGraph once, then iterationGraph until the residual is
+	// under the tolerance or maxIterations have run. Substepping puts the
+	// whole step in stepGraph.
+	TaskGraph stepGraph;
+	TaskGraph iterationGraph;
+	STEPMODE currentStepMode;
+	int substeps;
+	// Implicit steps are implicitScale fixed steps long
+	ImplicitIntegrator implicit;
+	int implicitScale;
+	bool adaptiveIterations;
+	float residualTolerance;
+	int minIterations;
+	int maxIterations;
+	// Resting parts of the cloth stop being simulated until disturbed
+	SleepTiles sleepTiles;
+	bool sleepEnabled;
+	// Average iterations per step over the last frame, and what they left
+	float lastIterations;
+	SpringResidual lastResidual;
+	TaskGraph frameGraph;
+	int pendingSteps;
+	glm::vec3 stepGravity;
+	// Seconds simulated since the last reset, which the flag's wind follows
+	float simulationTime;
+	WindField wind;
+	// Drag and lift on the flag's triangles
+	Aerodynamics aerodynamics;
+	// render() draws normals into renderNormals[drawnNormals] while the
+	// physics orients the flag by the other ones
+	std::array<std::vector<glm::vec3>, 2> renderNormals;
+	int drawnNormals;
 	static bool vsync;
 
 private:
@@ -128,6 +272,9 @@ private:
 	void initSprings();
 	void initClothMesh();
 	void initFlagMesh();
+	void allocateMeshBuffers();
+	void buildCloth();
+	void resizeCloth(int newRows, int newCols, float newSpacing);
 	void initSkybox();
 	void initCollisionObjects();
 	void processEvent();
@@ -135,18 +282,30 @@ private:
 	void handleMouseActivity();
 	void handleMouseTearing();
 	void tearSpringsAroundPoint(glm::vec3 worldPos, float radius);
-	void handleCollisions();
-	bool checkSphereCollision(const glm::vec3& particlePos, float& penetrationDepth, glm::vec3& normal);
-	bool checkCubeCollision(const glm::vec3& particlePos, float& penetrationDepth, glm::vec3& normal);
-	void resolveCollision(Particle& particle, const glm::vec3& normal, float penetrationDepth);
+	void rebuildParticleGrid();
+	void buildStepGraph();
+	TaskGraph::TaskId addIntegrationTasks(TaskGraph& graph, float dt, bool broadphase, TaskGraph::TaskId after);
+	TaskGraph::TaskId addIterationTasks(TaskGraph& graph, float dt, bool accelerate, TaskGraph::TaskId after);
+	bool accelerating() const;
+	bool constraintsAreForces() const;
+	float stepDt() const;
+	float stepLength() const;
+	void setStepping(STEPMODE mode, int count);
+	void applySpringMaterials();
+	TaskGraph::TaskId addParticleTasks(TaskGraph& graph, TaskGraph::RangeFunction fn);
+	void wakeAll();
+	int runConstraintIterations();
+	void updateWind();
+	void handleCollisions(size_t begin, size_t end);
+	void rebuildColliders();
 	glm::vec3 screenToWorld(glm::vec2 screenPos, float depth = 0.0f);
 	glm::vec2 worldToScreen(const glm::vec3& worldPos);
-	Particle* findClosestParticleToRay(glm::vec3 rayOrigin, glm::vec3 rayDir);
+	int findClosestParticleToRay(glm::vec3 rayOrigin, glm::vec3 rayDir);
 	void render();
 	void framebuffer_size_callback(int width, int height);
 	void reset();
 	void clean();
-	std::vector<glm::vec3> computeNormals(const std::vector<unsigned int>& indices);
+	void computeNormals(const std::vector<unsigned int>& indices, std::vector<glm::vec3>& normals);
 	void renderGUI();
 
 };
\ No newline at end of file
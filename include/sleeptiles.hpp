@@ -0,0 +1,90 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <span>
+#include <vector>
+#include "particlestore.hpp"
+
+// Particles along a side of a tile
+constexpr uint32_t SLEEP_TILE_SIZE = 8;
+
+// Contiguous particle indices [begin, end)
+struct ParticleRun {
+    uint32_t begin;
+    uint32_t end;
+};
+
+// Splits the cloth's rows x cols particle grid into square tiles. A tile
+// falls asleep once all its particles have stayed slower than sleepSpeed for
+// sleepSteps steps, and wakes when a neighbouring tile moves faster than
+// wakeSpeed. A sleeping tile's particles are frozen: their inverse masses are
+// set aside and zeroed, so every pass treats them as pinned, and the passes
+// that walk awakeRuns() skip them altogether. Anything else that changes
+// inverse masses has to wake everything first.
+class SleepTiles {
+public:
+    float sleepSpeed;
+    float wakeSpeed;
+    int sleepSteps;
+
+    SleepTiles();
+
+    void init(uint32_t rows, uint32_t cols);
+
+    // Call between steps with how many steps just ran and their length.
+    // True when a tile fell asleep or woke, so awakeRuns changed.
+    bool update(ParticleStore& particles, int steps, float dt);
+
+    // Wakes every tile and gives the particles their masses back. True if
+    // anything was asleep.
+    bool wakeAll(ParticleStore& particles);
+
+    bool allAsleep() const { return !asleep.empty() && sleeping == asleep.size(); }
+    size_t sleepingCount() const { return sleeping; }
+    size_t tileCount() const { return asleep.size(); }
+
+    // Awake particles, in index order
+    std::span<const ParticleRun> awakeRuns() const { return runs; }
+
+    // 1 for each particle that's asleep
+    std::span<const uint8_t> particleStates() const { return particleAsleep; }
+
+    // The inverse masses sleeping particles had before they froze; only
+    // meaningful where particleStates() is 1
+    std::span<const float> savedInverseMasses() const { return savedInvMass; }
+
+private:
+    uint32_t rows;
+    uint32_t cols;
+    uint32_t tilesX;
+    uint32_t tilesY;
+    std::vector<uint8_t> asleep;
+    std::vector<int> quietSteps;
+    std::vector<float> tileSpeeds;
+    size_t sleeping;
+
+    std::vector<float> savedInvMass;
+    std::vector<uint8_t> particleAsleep;
+    std::vector<ParticleRun> runs;
+
+    template<typename Function>
+    void forEachParticle(size_t tile, Function&& fn) const;
+    void sleep(ParticleStore& particles, size_t tile);
+    void wake(ParticleStore& particles, size_t tile);
+    bool neighbourMoving(size_t tile) const;
+    void buildRuns();
+};
+
+template<typename Function>
+void SleepTiles::forEachParticle(size_t tile, Function&& fn) const {
+    uint32_t x0 = static_cast<uint32_t>(tile % tilesX) * SLEEP_TILE_SIZE;
+    uint32_t y0 = static_cast<uint32_t>(tile / tilesX) * SLEEP_TILE_SIZE;
+    uint32_t x1 = std::min(x0 + SLEEP_TILE_SIZE, cols);
+    uint32_t y1 = std::min(y0 + SLEEP_TILE_SIZE, rows);
+
+    for (uint32_t y = y0; y < y1; ++y) {
+        for (uint32_t x = x0; x < x1; ++x) {
+            fn(y * cols + x);
+        }
+    }
+}
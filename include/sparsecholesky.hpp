@@ -0,0 +1,46 @@
+#pragma once
+#include <cstdint>
+#include <span>
+#include <vector>
+
+// A = L L^T for a sparse symmetric positive definite matrix, in doubles.
+// Rows are pivoted in a caller supplied order, which is what keeps the fill
+// down; the factor is stored column by column with the diagonal first.
+// Symbolic analysis (elimination tree and column counts) is redone by every
+// factor call, so the pattern may change freely between calls.
+class SparseCholesky {
+public:
+    SparseCholesky();
+
+    // The matrix comes as CSR rows holding both triangles; order[k] is the
+    // row pivoted k-th. False if the matrix isn't positive definite, which
+    // leaves the factor empty.
+    bool factor(std::span<const uint32_t> rowOffsets, std::span<const uint32_t> columns,
+        std::span<const double> values, std::span<const uint32_t> order);
+
+    // Overwrites b with A^-1 b. work needs one entry per row; solves with
+    // separate work vectors may run in parallel.
+    void solve(std::span<double> b, std::span<double> work) const;
+
+    bool empty() const { return columnOffsets.empty(); }
+    size_t size() const { return order.size(); }
+    size_t nonZeros() const { return factorValues.size(); }
+
+private:
+    std::vector<uint32_t> order;
+    std::vector<uint32_t> columnOffsets;
+    std::vector<uint32_t> factorRows;
+    std::vector<double> factorValues;
+
+    // Upper triangle of the pivoted matrix by column, and the scratch the
+    // factorization walks the elimination tree with
+    std::vector<uint32_t> upperOffsets;
+    std::vector<uint32_t> upperRows;
+    std::vector<double> upperValues;
+    std::vector<int32_t> parent;
+    std::vector<int32_t> ancestor;
+    std::vector<int32_t> marks;
+    std::vector<uint32_t> stack;
+
+    size_t reach(uint32_t k);
+};
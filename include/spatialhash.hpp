@@ -0,0 +1,80 @@
+#pragma once
+#include <cstdint>
+#include <span>
+#include <vector>
+#include <glm/glm.hpp>
+
+// Uniform grid over particle positions, hashed into a fixed-size table so it
+// needs no bounds. Particles are counting-sorted by slot, so everything in a
+// slot is contiguous. Distant cells can share a slot, so queries hand back
+// candidates and callers do the exact distance test.
+class SpatialHash {
+public:
+    SpatialHash();
+
+    void build(const glm::vec3* positions, size_t count, float cellSize);
+    // Only the listed particles; the entries are their indices
+    void build(const glm::vec3* positions, std::span<const uint32_t> indices, float cellSize);
+    void clear();
+
+    bool empty() const { return entries.empty(); }
+    float getCellSize() const { return cellSize; }
+
+    // Every hashed particle index, grouped by slot
+    std::span<const uint32_t> sortedParticles() const { return entries; }
+
+    // Calls fn(index) for every particle in a cell overlapping the sphere. A
+    // particle can come up twice when two of those cells share a slot.
+    template<typename Function>
+    void forEachCandidate(const glm::vec3& center, float radius, Function&& fn) const;
+
+    // Walks the cells along the ray and returns the particle closest to it,
+    // if one lies within maxDistance of the ray, or -1
+    int closestToRay(const glm::vec3* positions, const glm::vec3& origin, const glm::vec3& dir, float maxDistance) const;
+
+private:
+    float cellSize;
+    float invCellSize;
+    uint32_t slotMask;
+    glm::vec3 boundsMin;
+    glm::vec3 boundsMax;
+
+    // slotStart has one entry per slot plus an end marker
+    std::vector<uint32_t> slotStart;
+    std::vector<uint32_t> entries;
+    std::vector<uint32_t> particleSlots;
+
+    // Hashes count particles; index(k) is the k-th one's particle index
+    template<typename IndexFunction>
+    void fill(const glm::vec3* positions, size_t count, float size, IndexFunction&& index);
+
+    glm::ivec3 cellOf(const glm::vec3& p) const {
+        return glm::ivec3(glm::floor(p * invCellSize));
+    }
+
+    uint32_t slotOf(const glm::ivec3& cell) const {
+        uint32_t h = (static_cast<uint32_t>(cell.x) * 73856093u)
+                   ^ (static_cast<uint32_t>(cell.y) * 19349663u)
+                   ^ (static_cast<uint32_t>(cell.z) * 83492791u);
+        return h & slotMask;
+    }
+};
+
+template<typename Function>
+void SpatialHash::forEachCandidate(const glm::vec3& center, float radius, Function&& fn) const {
+    if (entries.empty()) return;
+
+    glm::ivec3 lo = cellOf(center - glm::vec3(radius));
+    glm::ivec3 hi = cellOf(center + glm::vec3(radius));
+
+    for (int z = lo.z; z <= hi.z; ++z) {
+        for (int y = lo.y; y <= hi.y; ++y) {
+            for (int x = lo.x; x <= hi.x; ++x) {
+                uint32_t slot = slotOf(glm::ivec3(x, y, z));
+                for (uint32_t k = slotStart[slot]; k < slotStart[slot + 1]; ++k) {
+                    fn(entries[k]);
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,129 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// This header is shared with the ISA-specific kernel translation units, which
+// are built with their own instruction set flags. Keep it free of glm and
+// other headers with inline code so nothing compiled for AVX2 can leak into
+// the rest of the program through the linker.
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define SPRING_KERNELS_X86 1
+#else
+#define SPRING_KERNELS_X86 0
+#endif
+
+enum class SPRINGTYPE : uint8_t {
+    STRUCTURAL,
+    SHEAR,
+    BEND,
+    LAST
+};
+
+// Stiffness and damping are shared by every spring of a type and looked up
+// through the spring's type id instead of being stored per spring.
+struct SpringMaterial {
+    float stiffness;
+    float damping;
+};
+
+// Packed 20-byte spring record. Particles are referenced by index so the
+// particle store can be reallocated without invalidating the springs.
+struct Spring {
+    uint32_t p1;
+    uint32_t p2;
+    float restLength;
+    float invRestLength;
+    SPRINGTYPE type;
+    uint8_t active;
+};
+
+static_assert(sizeof(Spring) == 20, "Spring record is expected to stay packed");
+
+// Vector kernels work through springs in groups of this many. No particle may
+// appear twice inside a group, so a whole group can be gathered and scattered
+// at once; springs of the same color always satisfy this.
+constexpr size_t SPRING_BATCH_WIDTH = 8;
+
+// Positions, previous positions and forces are tightly packed xyz triplets.
+struct SpringKernelArgs {
+    const Spring* springs;
+    size_t count;
+    const SpringMaterial* materials;
+    float* positions;
+    const float* prevPositions;
+    float* forces;
+    const float* invMass;
+};
+
+// Per spring type XPBD settings for one step. Compliance is inverse
+// stiffness in m/N; 0 makes the spring rigid.
+struct XpbdParams {
+    const float* compliance;
+    const float* damping;
+    float dt;
+};
+
+// Trilinear lookups in a grid of packed xyz vectors that tiles space: size
+// nodes along each axis, a power of two, x fastest. A point p sits at
+// (p - origin) * invCellSize in grid units. Points and results are packed
+// xyz triplets.
+struct GridSampleArgs {
+    const float* grid;
+    uint32_t size;
+    float origin[3];
+    float invCellSize;
+    const float* points;
+    size_t count;
+    float* out;
+};
+
+namespace SpringKernels
+{
+    enum class ISA {
+        SCALAR,
+        SSE41,
+        AVX2
+    };
+
+    ISA detectISA();
+    const char* isaName(ISA isa);
+
+    // The vector kernels expect count to be a multiple of SPRING_BATCH_WIDTH
+    // and every batch to be conflict free.
+    void applyForces(ISA isa, const SpringKernelArgs& args);
+    void satisfyConstraints(ISA isa, const SpringKernelArgs& args);
+
+    void applyForcesScalar(const SpringKernelArgs& args);
+    void satisfyConstraintsScalar(const SpringKernelArgs& args);
+
+    // Jacobi variant of satisfyConstraints: leaves the particles alone and
+    // writes the correction each spring wants for its first particle to
+    // `corrections`, packed xyz per spring. Zero means nothing to correct.
+    void jacobiCorrectionsScalar(const SpringKernelArgs& args, float* corrections);
+
+    // XPBD projection of each spring as a distance constraint. lambdas holds
+    // one Lagrange multiplier per spring, accumulated over the step's
+    // iterations, so the result tends to the same stiffness however many
+    // iterations run and whatever the step length.
+    void xpbdScalar(const SpringKernelArgs& args, const XpbdParams& params, float* lambdas);
+
+    // How far each spring is from satisfied, relative to its rest length,
+    // folded into a running maximum and sum of squares. With params that's
+    // what xpbdScalar would still correct; without, only stretch past the
+    // clamp of satisfyConstraints counts.
+    void residualScalar(const SpringKernelArgs& args, const XpbdParams* params, const float* lambdas, float& maxViolation, float& sumSquares);
+
+    // Any count. Every kernel gives the same bits as the scalar one.
+    void sampleGrid(ISA isa, const GridSampleArgs& args);
+    void sampleGridScalar(const GridSampleArgs& args);
+
+#if SPRING_KERNELS_X86
+    void applyForcesSSE41(const SpringKernelArgs& args);
+    void satisfyConstraintsSSE41(const SpringKernelArgs& args);
+    void applyForcesAVX2(const SpringKernelArgs& args);
+    void satisfyConstraintsAVX2(const SpringKernelArgs& args);
+    void sampleGridSSE41(const GridSampleArgs& args);
+    void sampleGridAVX2(const GridSampleArgs& args);
+#endif
+}
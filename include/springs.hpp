@@ -1,18 +1,227 @@
 #pragma once
-#include "particle.hpp"
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <span>
+#include <vector>
+#include "particlestore.hpp"
+#include "springkernels.hpp"
+#include "jobsystem.hpp"
 
-class Spring {
-public:  
-    Particle* p1;
-    Particle* p2;
+// Contiguous run of springs that share no particle with each other. Springs in
+// [begin, end) are live; torn ones are swapped out to [end, capacityEnd).
+struct SpringColor {
+    size_t begin;
+    size_t end;
+    size_t capacityEnd;
 
-private:
-    float stiffness;
-    float restLength;
-    float damping;
+    size_t liveCount() const { return end - begin; }
+};
+
+// Springs per parallel chunk; a multiple of the vector batch width
+constexpr size_t SPRING_PARALLEL_GRAIN = 256 * SPRING_BATCH_WIDTH;
+
+// Constraint violation over the live springs, as a fraction of rest length
+struct SpringResidual {
+    float max;
+    float rms;
+};
 
+// Particles per chunk when the Jacobi solver gathers corrections
+constexpr size_t JACOBI_PARTICLE_GRAIN = 1024;
+
+class SpringBuffer {
 public:
-    Spring(Particle* particleA, Particle* particleB, float k, float dampingCoeff = 0.1f);
-    void applyForces();
-    void satisfyConstraint();
-};
\ No newline at end of file
+    std::array<SpringMaterial, static_cast<size_t>(SPRINGTYPE::LAST)> materials{};
+
+    // Scales the averaged Jacobi correction; above 1 makes up for averaging
+    float jacobiRelaxation;
+
+    // XPBD compliance per spring type; damping comes from the materials
+    std::array<float, static_cast<size_t>(SPRINGTYPE::LAST)> compliance{};
+
+    SpringBuffer();
+
+    void clear();
+    void reserve(size_t count);
+    uint32_t add(const ParticleStore& particles, uint32_t particleA, uint32_t particleB, SPRINGTYPE type);
+
+    // Greedy edge coloring so that no two springs of a color share a particle,
+    // then reorders the springs color by color. Springs of one color can be
+    // projected in parallel and in vector batches. Springs added afterwards,
+    // or ones that don't fit the palette, run serially until the next call.
+    // Also rebuilds the per-particle spring lists the Jacobi solver uses.
+    void buildColors(size_t particleCount);
+
+    size_t colorCount() const { return colors.size(); }
+
+    void setMaterial(SPRINGTYPE type, float k, float dampingCoeff);
+    void setCompliance(SPRINGTYPE type, float value) { compliance[static_cast<size_t>(type)] = value; }
+    const SpringMaterial& material(SPRINGTYPE type) const { return materials[static_cast<size_t>(type)]; }
+
+    // Brings every torn spring back. Spring indices change, so anything that
+    // captured ranges (task graphs) has to be rebuilt.
+    void activateAll();
+
+    // Tears every live spring the predicate picks. A torn spring is swapped
+    // with the last live spring of its color, so colors stay conflict free
+    // and live springs stay dense. Returns how many were torn; when that's
+    // not zero, spring indices and live ranges have changed.
+    template<typename Predicate>
+    size_t tearWhere(Predicate&& shouldTear);
+
+    // Same, but only looks at the given spring indices, which may repeat.
+    // The list is reordered.
+    template<typename Predicate>
+    size_t tearWhere(std::vector<uint32_t>& candidates, Predicate&& shouldTear);
+
+    // Live springs attached to a particle. Empty until buildColors has run.
+    std::span<const uint32_t> springsOf(uint32_t particle) const;
+
+    // Visits live springs only
+    template<typename Function>
+    void forEachLive(Function&& fn) const;
+
+    // Chunks of springs whose particles are all asleep get skipped by the
+    // tasks. Empty means nothing sleeps. Call before adding tasks, and again
+    // whenever the sleeping particles or the live ranges change.
+    void setSleeping(std::span<const uint8_t> particleAsleep);
+
+    void setISA(SpringKernels::ISA kernelISA) { isa = kernelISA; }
+    SpringKernels::ISA getISA() const { return isa; }
+
+    size_t size() const { return springs.size(); }
+    size_t liveCount() const { return live; }
+    float getMaxRestLength() const { return maxRestLength; }
+    bool empty() const { return springs.empty(); }
+
+    Spring& operator[](size_t i) { return springs[i]; }
+    const Spring& operator[](size_t i) const { return springs[i]; }
+
+    // Append one task per color, chained after `after`, plus a serial task for
+    // the uncolored tail. Returns the last task. The tasks capture the current
+    // live ranges, so the graph has to be rebuilt after buildColors, tearing
+    // or activateAll.
+    TaskGraph::TaskId addForceTasks(TaskGraph& graph, ParticleStore& particles, TaskGraph::TaskId after) const;
+    TaskGraph::TaskId addConstraintTasks(TaskGraph& graph, ParticleStore& particles, TaskGraph::TaskId after) const;
+
+    // One Jacobi sweep: every spring computes its correction from the same
+    // positions, then every particle adds up the corrections of its springs
+    // in a fixed order and moves by their relaxed average. Needs no coloring,
+    // and the result doesn't depend on how the work is split across threads.
+    TaskGraph::TaskId addJacobiTasks(TaskGraph& graph, ParticleStore& particles, TaskGraph::TaskId after);
+
+    // XPBD: the multipliers are zeroed once at the start of a step, then each
+    // iteration projects color by color like addConstraintTasks. The spring
+    // forces are part of the constraints here, so don't add force tasks too.
+    TaskGraph::TaskId addXpbdResetTasks(TaskGraph& graph, TaskGraph::TaskId after);
+    TaskGraph::TaskId addXpbdTasks(TaskGraph& graph, ParticleStore& particles, float dt, TaskGraph::TaskId after);
+
+    // Measures how far the live springs are from satisfied, as the XPBD
+    // solver sees them or as the clamp of the other two does. Each chunk
+    // writes its own partial result; residual() combines them once the
+    // graph has run.
+    TaskGraph::TaskId addResidualTasks(TaskGraph& graph, ParticleStore& particles, bool xpbd, float dt, TaskGraph::TaskId after);
+    SpringResidual residual() const;
+
+private:
+    AlignedVector<Spring> springs;
+    std::vector<SpringColor> colors;
+    // Springs that didn't get a color; always projected serially
+    SpringColor tail;
+    size_t live;
+    float maxRestLength;
+    SpringKernels::ISA isa;
+
+    // Live springs touching each particle, CSR style: particle i owns the
+    // slots from particleSpringOffsets[i], the first particleSpringCounts[i]
+    // of which are in use. One Jacobi correction per spring.
+    std::vector<uint32_t> particleSpringOffsets;
+    std::vector<uint32_t> particleSpringCounts;
+    std::vector<uint32_t> particleSprings;
+    AlignedVector<glm::vec3> jacobiCorrections;
+    // One XPBD multiplier per spring
+    AlignedVector<float> lambdas;
+
+    // One per residual chunk, padded so chunks don't share cache lines
+    struct alignas(64) ResidualPartial {
+        float maxViolation;
+        float sumSquares;
+    };
+    std::vector<ResidualPartial> residualPartials;
+
+    // One flag per parallel chunk, colors in order and then the tail
+    std::vector<uint8_t> sleepingChunks;
+    static size_t chunksOf(const SpringColor& range) { return (range.liveCount() + SPRING_PARALLEL_GRAIN - 1) / SPRING_PARALLEL_GRAIN; }
+    bool chunkAsleep(size_t chunk) const { return !sleepingChunks.empty() && sleepingChunks[chunk]; }
+
+    void buildParticleSprings(size_t particleCount);
+    void unlinkParticleSpring(uint32_t particle, uint32_t spring);
+    void relinkParticleSpring(uint32_t particle, uint32_t from, uint32_t to);
+    void tear(SpringColor& range, size_t i);
+    SpringColor& rangeOf(size_t i);
+    void applyJacobiRange(ParticleStore& particles, size_t begin, size_t end) const;
+
+    SpringKernelArgs makeArgs(ParticleStore& particles, size_t first, size_t count) const;
+    void applyForcesRange(ParticleStore& particles, size_t first, size_t count) const;
+    void satisfyConstraintsRange(ParticleStore& particles, size_t first, size_t count) const;
+    XpbdParams xpbdParams(float dt, std::array<float, static_cast<size_t>(SPRINGTYPE::LAST)>& damping) const;
+    void xpbdRange(ParticleStore& particles, size_t first, size_t count, float dt);
+    void residualRange(ParticleStore& particles, size_t first, size_t count, bool xpbd, float dt, ResidualPartial& partial) const;
+};
+
+template<typename Predicate>
+size_t SpringBuffer::tearWhere(Predicate&& shouldTear) {
+    size_t torn = 0;
+
+    auto sweep = [&](SpringColor& range) {
+        // A tear pulls an unvisited spring into slot i, so don't advance
+        for (size_t i = range.begin; i < range.end;) {
+            if (shouldTear(springs[i])) {
+                tear(range, i);
+                ++torn;
+            }
+            else {
+                ++i;
+            }
+        }
+    };
+
+    for (SpringColor& color : colors) {
+        sweep(color);
+    }
+    sweep(tail);
+
+    return torn;
+}
+
+template<typename Predicate>
+size_t SpringBuffer::tearWhere(std::vector<uint32_t>& candidates, Predicate&& shouldTear) {
+    // Highest index first: a tear only ever moves the last live spring of a
+    // color, which is then never a candidate that's still waiting
+    std::sort(candidates.begin(), candidates.end(), std::greater<uint32_t>());
+    candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+
+    size_t torn = 0;
+    for (uint32_t i : candidates) {
+        SpringColor& range = rangeOf(i);
+        if (i >= range.end || !shouldTear(springs[i])) continue;
+
+        tear(range, i);
+        ++torn;
+    }
+    return torn;
+}
+
+template<typename Function>
+void SpringBuffer::forEachLive(Function&& fn) const {
+    for (const SpringColor& color : colors) {
+        for (size_t i = color.begin; i < color.end; ++i) {
+            fn(springs[i]);
+        }
+    }
+    for (size_t i = tail.begin; i < tail.end; ++i) {
+        fn(springs[i]);
+    }
+}
@@ -0,0 +1,110 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+#include "alignedallocator.hpp"
+#include "jobsystem.hpp"
+#include "springkernels.hpp"
+
+// Grid nodes along each axis of the wind tile; a power of two, so lookups
+// wrap with a mask
+constexpr uint32_t WIND_GRID_SIZE = 16;
+// Noise lattice cells across the tile in the coarsest octave
+constexpr uint32_t WIND_NOISE_CELLS = 4;
+
+// Turbulent wind: a steady mean flow that rises and falls in gusts, plus
+// swirls that are the curl of a vector potential built from seeded gradient
+// noise, so they have no sources or sinks. The swirls are baked into a grid
+// that tiles space and is carried downwind with the mean flow. Each noise
+// pattern is baked once, and the next one is baked when the field starts
+// blending towards it; a step only mixes the two tiles and adds the mean
+// flow. Particles read it back with trilinear lookups. Everything follows
+// from the seed and the simulation time, so a replay blows the same way.
+class WindField {
+public:
+    uint32_t seed;
+    // Mean flow, in m/s along the direction
+    glm::vec3 direction;
+    float meanSpeed;
+    // How far the gusts take the mean speed up and down, as a fraction of it
+    float gustiness;
+    // Typical speed of the swirls, in m/s
+    float turbulence;
+    // Size of the largest swirls, in m; the tile is WIND_NOISE_CELLS of them
+    // across
+    float scale;
+    // How quickly the swirls change shape, in new patterns per second
+    float evolution;
+
+    WindField();
+
+    // Serial, once per step before the update tasks run
+    void advance(float time);
+
+    // Bakes new patterns if advance() moved on to them, then mixes the
+    // velocities for this step
+    TaskGraph::TaskId addUpdateTasks(TaskGraph& graph, TaskGraph::TaskId after);
+
+    // Forgets the baked patterns, after the seed or scale changed
+    void invalidate() { bakedSlice = INVALID_SLICE; }
+
+    glm::vec3 sample(const glm::vec3& p) const;
+    // The same lookup for a run of points, with the vector kernels
+    void sample(const glm::vec3* points, size_t count, glm::vec3* out) const;
+
+    void setISA(SpringKernels::ISA kernelISA) { isa = kernelISA; }
+
+private:
+    static constexpr int32_t INVALID_SLICE = INT32_MIN;
+    static constexpr size_t NODE_COUNT = static_cast<size_t>(WIND_GRID_SIZE) * WIND_GRID_SIZE * WIND_GRID_SIZE;
+
+    SpringKernels::ISA isa;
+
+    // Values of the last advance()
+    glm::vec3 meanVelocity;
+    glm::vec3 drift;
+    float invCellSize;
+    int32_t slice;
+    float sliceBlend;
+
+    // Swirls of the pattern at `bakedSlice` and the one after it; then the
+    // mixed velocities, mean flow included. x fastest. This step bakes the
+    // next pattern, or both.
+    int32_t bakedSlice;
+    bool bakeNext;
+    bool bakeBoth;
+    AlignedVector<glm::vec3> swirls[2];
+    int current;
+    AlignedVector<glm::vec3> potential;
+    AlignedVector<glm::vec3> velocity;
+
+    static size_t node(uint32_t x, uint32_t y, uint32_t z) {
+        return (static_cast<size_t>(z) * WIND_GRID_SIZE + y) * WIND_GRID_SIZE + x;
+    }
+
+    void computePotential(int32_t pattern, uint32_t z0, uint32_t z1);
+    void computeSwirls(AlignedVector<glm::vec3>& out, uint32_t z0, uint32_t z1) const;
+    void mixVelocities(uint32_t z0, uint32_t z1);
+};
+
+inline glm::vec3 WindField::sample(const glm::vec3& p) const {
+    constexpr uint32_t mask = WIND_GRID_SIZE - 1;
+    const glm::vec3 g = (p - drift) * invCellSize;
+    const glm::vec3 cell = glm::floor(g);
+    const glm::vec3 t = g - cell;
+
+    // Two's complement wraps negative cells the right way round
+    const uint32_t x0 = static_cast<uint32_t>(static_cast<int32_t>(cell.x)) & mask;
+    const uint32_t y0 = static_cast<uint32_t>(static_cast<int32_t>(cell.y)) & mask;
+    const uint32_t z0 = static_cast<uint32_t>(static_cast<int32_t>(cell.z)) & mask;
+    const uint32_t x1 = (x0 + 1) & mask;
+    const uint32_t y1 = (y0 + 1) & mask;
+    const uint32_t z1 = (z0 + 1) & mask;
+
+    const glm::vec3* v = velocity.data();
+    const glm::vec3 x00 = glm::mix(v[node(x0, y0, z0)], v[node(x1, y0, z0)], t.x);
+    const glm::vec3 x10 = glm::mix(v[node(x0, y1, z0)], v[node(x1, y1, z0)], t.x);
+    const glm::vec3 x01 = glm::mix(v[node(x0, y0, z1)], v[node(x1, y0, z1)], t.x);
+    const glm::vec3 x11 = glm::mix(v[node(x0, y1, z1)], v[node(x1, y1, z1)], t.x);
+    return glm::mix(glm::mix(x00, x10, t.y), glm::mix(x01, x11, t.y), t.z);
+}
@@ -0,0 +1,108 @@
+#include "aerodynamics.hpp"
+#include <algorithm>
+#include <cmath>
+
+Aerodynamics::Aerodynamics()
+    : drag(30.0f)
+    , lift(15.0f)
+    , friction(5.0f)
+    , tileTriangles(0)
+    , tileCount(0)
+    , normals(nullptr)
+{
+}
+
+void Aerodynamics::build(const ParticleStore& particles, const std::vector<unsigned int>& indices, size_t rowTriangles) {
+    triangles.assign(indices.begin(), indices.end());
+
+    const size_t count = triangles.size() / 3;
+    areas.resize(count);
+    for (size_t t = 0; t < count; ++t) {
+        const glm::vec3& a = particles.restPositions[triangles[t * 3 + 0]];
+        const glm::vec3& b = particles.restPositions[triangles[t * 3 + 1]];
+        const glm::vec3& c = particles.restPositions[triangles[t * 3 + 2]];
+        areas[t] = 0.5f * glm::length(glm::cross(b - a, c - a));
+    }
+
+    tileTriangles = std::max<size_t>(rowTriangles * AERO_TILE_ROWS, 1);
+    tileCount = (count + tileTriangles - 1) / tileTriangles;
+}
+
+TaskGraph::TaskId Aerodynamics::addForceTasks(TaskGraph& graph, ParticleStore& particles, const WindField& wind, float dt, TaskGraph::TaskId after) {
+    TaskGraph::TaskId last = after;
+    for (size_t parity = 0; parity < 2; ++parity) {
+        const size_t tiles = (tileCount + 1 - parity) / 2;
+        if (tiles == 0) continue;
+
+        TaskGraph::TaskId scattered = graph.addParallelFor(tiles, 1, [this, &particles, &wind, dt, parity](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) {
+                applyTile(particles, wind, dt, i * 2 + parity);
+            }
+        });
+        graph.precede(last, scattered);
+        last = scattered;
+    }
+    return last;
+}
+
+void Aerodynamics::applyTile(ParticleStore& particles, const WindField& wind, float dt, size_t tile) const {
+    if (normals == nullptr) return;
+
+    const size_t first = tile * tileTriangles;
+    const size_t last = std::min(first + tileTriangles, areas.size());
+    const float invDt = 1.0f / dt;
+    const float third = 1.0f / 3.0f;
+
+    // The wind at a run of centroids is looked up at once, so the vector
+    // kernels can take them several at a time
+    glm::vec3 centroids[AERO_SAMPLE_BATCH];
+    glm::vec3 winds[AERO_SAMPLE_BATCH];
+
+    for (size_t t = first; t < last; ++t) {
+        const size_t run = (t - first) % AERO_SAMPLE_BATCH;
+        if (run == 0) {
+            const size_t count = std::min(last - t, AERO_SAMPLE_BATCH);
+            for (size_t k = 0; k < count; ++k) {
+                const uint32_t* corners = &triangles[(t + k) * 3];
+                centroids[k] = (particles.positions[corners[0]] + particles.positions[corners[1]] + particles.positions[corners[2]]) * third;
+            }
+            wind.sample(centroids, count, winds);
+        }
+
+        const uint32_t ia = triangles[t * 3 + 0];
+        const uint32_t ib = triangles[t * 3 + 1];
+        const uint32_t ic = triangles[t * 3 + 2];
+
+        const glm::vec3 velocity = (particles.positions[ia] - particles.prevPositions[ia] +
+            particles.positions[ib] - particles.prevPositions[ib] +
+            particles.positions[ic] - particles.prevPositions[ic]) * (third * invDt);
+        const glm::vec3 v = winds[run] - velocity;
+
+        const float speedSq = glm::dot(v, v);
+        const glm::vec3 normalSum = normals[ia] + normals[ib] + normals[ic];
+        const float normalLengthSq = glm::dot(normalSum, normalSum);
+        if (speedSq < 1e-8f || normalLengthSq < 1e-8f) continue;
+
+        // Facing downwind, so the normal force pushes along the flow
+        glm::vec3 n = normalSum / std::sqrt(normalLengthSq);
+        float vn = glm::dot(v, n);
+        if (vn < 0.0f) {
+            n = -n;
+            vn = -vn;
+        }
+
+        const float speed = std::sqrt(speedSq);
+        const glm::vec3 tangential = v - vn * n;
+        const glm::vec3 force = areas[t] * (
+            drag * vn * v +
+            lift * vn * (speed * n - (vn / speed) * v) +
+            friction * glm::length(tangential) * tangential);
+
+        const glm::vec3 share = force * third;
+        for (uint32_t corner : { ia, ib, ic }) {
+            if (particles.invMass[corner] > 0.0f) {
+                particles.addForce(corner, share);
+            }
+        }
+    }
+}
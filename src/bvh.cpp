@@ -0,0 +1,87 @@
+#include "bvh.hpp"
+#include <algorithm>
+#include <numeric>
+
+void Bvh::clear() {
+    nodes.clear();
+    items.clear();
+    leafLo.clear();
+    leafHi.clear();
+}
+
+void Bvh::build(const glm::vec3* itemLo, const glm::vec3* itemHi, size_t count) {
+    clear();
+    if (count == 0) return;
+
+    items.resize(count);
+    std::iota(items.begin(), items.end(), 0u);
+
+    // A median split tree has fewer than 2 * count / BVH_LEAF_SIZE + 1 nodes
+    nodes.reserve(2 * (count / BVH_LEAF_SIZE + 1));
+    buildNode(itemLo, itemHi, 0, static_cast<uint32_t>(count));
+
+    leafLo.resize(count);
+    leafHi.resize(count);
+    refit(itemLo, itemHi);
+}
+
+uint32_t Bvh::buildNode(const glm::vec3* itemLo, const glm::vec3* itemHi, uint32_t first, uint32_t count) {
+    uint32_t index = static_cast<uint32_t>(nodes.size());
+    nodes.emplace_back();
+
+    // Node bounds are filled in by the refit at the end of build
+    if (count <= BVH_LEAF_SIZE) {
+        nodes[index].rightOrFirst = first;
+        nodes[index].count = count;
+        return index;
+    }
+
+    glm::vec3 centerLo = (itemLo[items[first]] + itemHi[items[first]]) * 0.5f;
+    glm::vec3 centerHi = centerLo;
+    for (uint32_t k = first + 1; k < first + count; ++k) {
+        glm::vec3 center = (itemLo[items[k]] + itemHi[items[k]]) * 0.5f;
+        centerLo = glm::min(centerLo, center);
+        centerHi = glm::max(centerHi, center);
+    }
+
+    // Split at the median along the axis the centers spread the most
+    glm::vec3 extent = centerHi - centerLo;
+    int axis = extent.x > extent.y ? (extent.x > extent.z ? 0 : 2) : (extent.y > extent.z ? 1 : 2);
+    uint32_t half = count / 2;
+
+    std::nth_element(items.begin() + first, items.begin() + first + half, items.begin() + first + count,
+        [&](uint32_t a, uint32_t b) {
+            return itemLo[a][axis] + itemHi[a][axis] < itemLo[b][axis] + itemHi[b][axis];
+        });
+
+    buildNode(itemLo, itemHi, first, half);
+    uint32_t right = buildNode(itemLo, itemHi, first + half, count - half);
+
+    nodes[index].rightOrFirst = right;
+    nodes[index].count = 0;
+    return index;
+}
+
+void Bvh::refit(const glm::vec3* itemLo, const glm::vec3* itemHi) {
+    // Children sit after their parent, so walking backwards sees them first
+    for (size_t n = nodes.size(); n-- > 0;) {
+        Node& node = nodes[n];
+
+        if (node.count > 0) {
+            node.lo = itemLo[items[node.rightOrFirst]];
+            node.hi = itemHi[items[node.rightOrFirst]];
+            for (uint32_t k = node.rightOrFirst; k < node.rightOrFirst + node.count; ++k) {
+                leafLo[k] = itemLo[items[k]];
+                leafHi[k] = itemHi[items[k]];
+                node.lo = glm::min(node.lo, leafLo[k]);
+                node.hi = glm::max(node.hi, leafHi[k]);
+            }
+        }
+        else {
+            const Node& left = nodes[n + 1];
+            const Node& right = nodes[node.rightOrFirst];
+            node.lo = glm::min(left.lo, right.lo);
+            node.hi = glm::max(left.hi, right.hi);
+        }
+    }
+}
@@ -0,0 +1,512 @@
+#include "colliders.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace
+{
+    // How far below a mesh surface a particle is still looked for. Deeper
+    // than this and it is taken to be outside.
+    constexpr float MESH_SEARCH_DEPTH = 0.25f;
+
+    // A sweep counts as touching once this close to the contact surface
+    constexpr float CCD_TOLERANCE = 0.001f;
+
+    // Conservative advancement steps before a sweep is called a miss
+    constexpr int CCD_MAX_STEPS = 16;
+
+    // Puts the particle back on the surface and reworks its Verlet velocity
+    // so the cloth grips, slides and barely bounces like a washcloth
+    void resolveContact(ParticleStore& particles, size_t index, const glm::vec3& normal, float penetrationDepth) {
+        glm::vec3& position = particles.positions[index];
+
+        // Move particle out of collision object
+        position += normal * penetrationDepth;
+
+        // Calculate current velocity from Verlet integration
+        glm::vec3 velocity = position - particles.prevPositions[index];
+
+        // Decompose velocity into normal and tangential components
+        float normalVel = glm::dot(velocity, normal);
+        glm::vec3 normalComponent = normalVel * normal;
+        glm::vec3 tangentialComponent = velocity - normalComponent;
+        float tangentialSpeed = glm::length(tangentialComponent);
+
+        // Washcloth parameters
+        const float staticFriction = 0.9f;      // Washcloth grips surfaces
+        const float kineticFriction = 0.7f;     // Lower when already moving
+        const float dampening = 0.85f;          // Absorb energy like fabric
+        const float restitution = 0.02f;        // Minimal bounce
+        const float gripThreshold = 0.5f;       // Speed below which static friction kicks in
+
+        // Handle normal component (into/out of surface)
+        glm::vec3 newNormalComponent;
+        if (normalVel < 0) {
+            newNormalComponent = -normalVel * restitution * normal;
+        }
+        else {
+            newNormalComponent = normalVel * normal * 0.95f;
+        }
+
+        // Handle tangential component (sliding along surface)
+        glm::vec3 newTangentialComponent;
+
+        if (tangentialSpeed < gripThreshold) {
+            // Static Friction
+            newTangentialComponent = tangentialComponent * (1.0f - staticFriction);
+        }
+        else {
+            // Kinetic Friction
+            if (tangentialSpeed > 0.0001f) {
+                glm::vec3 tangentialDirection = tangentialComponent / tangentialSpeed;
+                float newTangentialSpeed = tangentialSpeed * (1.0f - kineticFriction);
+                newTangentialComponent = tangentialDirection * newTangentialSpeed;
+            }
+            else {
+                newTangentialComponent = glm::vec3(0.0f);
+            }
+        }
+
+        // Combine components with overall dampening
+        glm::vec3 newVelocity = (newNormalComponent + newTangentialComponent) * dampening;
+
+        // Update previous position based on new velocity
+        particles.prevPositions[index] = position - newVelocity;
+    }
+
+    float roundDistance(const glm::vec3& diff, float radius, glm::vec3& normal) {
+        float distance = glm::length(diff);
+        normal = (distance > 0.0001f) ? diff / distance : glm::vec3(0.0f, 1.0f, 0.0f);
+        return distance - radius;
+    }
+}
+
+void ColliderSet::clear() {
+    types.clear();
+    centers.clear();
+    halfExtents.clear();
+    axes.clear();
+    radii.clear();
+    meshes.clear();
+    sdfs.clear();
+    margins.clear();
+    bounded.clear();
+    boundsLo.clear();
+    boundsHi.clear();
+    planes.clear();
+    bvh.clear();
+    structureDirty = false;
+    boundsDirty = false;
+}
+
+uint32_t ColliderSet::push(COLLIDERTYPE type, const glm::vec3& center, float margin) {
+    uint32_t id = static_cast<uint32_t>(types.size());
+    types.push_back(type);
+    centers.push_back(center);
+    halfExtents.push_back(glm::vec3(0.0f));
+    axes.push_back(glm::vec3(0.0f));
+    radii.push_back(0.0f);
+    meshes.push_back(nullptr);
+    sdfs.push_back(nullptr);
+    margins.push_back(margin);
+
+    if (type == COLLIDERTYPE::PLANE) {
+        planes.push_back(id);
+    }
+    else {
+        bounded.push_back(id);
+        boundsLo.emplace_back(0.0f);
+        boundsHi.emplace_back(0.0f);
+        structureDirty = true;
+    }
+    return id;
+}
+
+uint32_t ColliderSet::addSphere(const glm::vec3& center, float radius, float margin) {
+    uint32_t id = push(COLLIDERTYPE::SPHERE, center, margin);
+    radii[id] = radius;
+    computeBounds(bounded.size() - 1);
+    return id;
+}
+
+uint32_t ColliderSet::addBox(const glm::vec3& center, const glm::vec3& extents, float margin) {
+    uint32_t id = push(COLLIDERTYPE::BOX, center, margin);
+    halfExtents[id] = extents;
+    computeBounds(bounded.size() - 1);
+    return id;
+}
+
+uint32_t ColliderSet::addCapsule(const glm::vec3& a, const glm::vec3& b, float radius, float margin) {
+    uint32_t id = push(COLLIDERTYPE::CAPSULE, (a + b) * 0.5f, margin);
+    axes[id] = (b - a) * 0.5f;
+    radii[id] = radius;
+    computeBounds(bounded.size() - 1);
+    return id;
+}
+
+uint32_t ColliderSet::addPlane(const glm::vec3& point, const glm::vec3& normal, float margin) {
+    uint32_t id = push(COLLIDERTYPE::PLANE, point, margin);
+    axes[id] = glm::normalize(normal);
+    return id;
+}
+
+uint32_t ColliderSet::addMesh(const MeshCollider& mesh, const glm::vec3& origin, float thickness, float margin) {
+    uint32_t id = push(COLLIDERTYPE::MESH, origin, margin);
+    meshes[id] = &mesh;
+    radii[id] = thickness;
+    computeBounds(bounded.size() - 1);
+    return id;
+}
+
+uint32_t ColliderSet::addSdf(const SdfCollider& sdf, const glm::vec3& origin, float thickness, float margin) {
+    uint32_t id = push(COLLIDERTYPE::SDF, origin, margin);
+    sdfs[id] = &sdf;
+    radii[id] = thickness;
+    computeBounds(bounded.size() - 1);
+    return id;
+}
+
+void ColliderSet::setCenter(uint32_t id, const glm::vec3& center) {
+    centers[id] = center;
+    if (types[id] == COLLIDERTYPE::PLANE) return;
+
+    auto it = std::find(bounded.begin(), bounded.end(), id);
+    computeBounds(it - bounded.begin());
+    boundsDirty = true;
+}
+
+void ColliderSet::computeBounds(size_t item) {
+    uint32_t id = bounded[item];
+    glm::vec3 extent(margins[id]);
+
+    switch (types[id]) {
+    case COLLIDERTYPE::SPHERE:
+        extent += glm::vec3(radii[id]);
+        break;
+    case COLLIDERTYPE::BOX:
+        extent += halfExtents[id];
+        break;
+    case COLLIDERTYPE::CAPSULE:
+        extent += glm::abs(axes[id]) + glm::vec3(radii[id]);
+        break;
+    case COLLIDERTYPE::MESH:
+        extent += glm::vec3(radii[id]);
+        boundsLo[item] = centers[id] + meshes[id]->getBoundsMin() - extent;
+        boundsHi[item] = centers[id] + meshes[id]->getBoundsMax() + extent;
+        return;
+    case COLLIDERTYPE::SDF:
+        // Nothing outside the grid can be sampled
+        boundsLo[item] = centers[id] + sdfs[id]->getBoundsMin();
+        boundsHi[item] = centers[id] + sdfs[id]->getBoundsMax();
+        return;
+    default:
+        break;
+    }
+
+    boundsLo[item] = centers[id] - extent;
+    boundsHi[item] = centers[id] + extent;
+}
+
+void ColliderSet::update() {
+    if (structureDirty) {
+        bvh.build(boundsLo.data(), boundsHi.data(), bounded.size());
+    }
+    else if (boundsDirty) {
+        bvh.refit(boundsLo.data(), boundsHi.data());
+    }
+    structureDirty = false;
+    boundsDirty = false;
+}
+
+template <COLLIDERTYPE Type>
+float ColliderSet::shapeDistance(uint32_t id, const glm::vec3& diff, glm::vec3& normal) const {
+    if constexpr (Type == COLLIDERTYPE::SPHERE) {
+        return roundDistance(diff, radii[id], normal);
+    }
+    else if constexpr (Type == COLLIDERTYPE::CAPSULE) {
+        const glm::vec3& axis = axes[id];
+        float axisLengthSq = glm::dot(axis, axis);
+        float t = axisLengthSq > 0.0f ? glm::clamp(glm::dot(diff, axis) / axisLengthSq, -1.0f, 1.0f) : 0.0f;
+        return roundDistance(diff - axis * t, radii[id], normal);
+    }
+    else if constexpr (Type == COLLIDERTYPE::BOX) {
+        const glm::vec3& halfSize = halfExtents[id];
+        glm::vec3 outside = glm::abs(diff) - halfSize;
+
+        if (outside.x < 0.0f && outside.y < 0.0f && outside.z < 0.0f) {
+            // Inside: leave through the closest face
+            glm::vec3 distances = -outside;
+            float minDist = std::min({ distances.x, distances.y, distances.z });
+
+            if (minDist == distances.x) {
+                normal = glm::vec3(diff.x > 0 ? 1.0f : -1.0f, 0.0f, 0.0f);
+            }
+            else if (minDist == distances.y) {
+                normal = glm::vec3(0.0f, diff.y > 0 ? 1.0f : -1.0f, 0.0f);
+            }
+            else {
+                normal = glm::vec3(0.0f, 0.0f, diff.z > 0 ? 1.0f : -1.0f);
+            }
+            return -minDist;
+        }
+
+        glm::vec3 offset = glm::max(outside, glm::vec3(0.0f)) * glm::sign(diff);
+        return roundDistance(offset, 0.0f, normal);
+    }
+    else if constexpr (Type == COLLIDERTYPE::PLANE) {
+        normal = axes[id];
+        return glm::dot(diff, normal);
+    }
+    else if constexpr (Type == COLLIDERTYPE::MESH) {
+        // The side comes from the closest triangle's face normal
+        glm::vec3 closest, faceNormal;
+        float reach = radii[id] + margins[id] + MESH_SEARCH_DEPTH;
+        if (!meshes[id]->closestPoint(diff, reach, closest, faceNormal)) {
+            return std::numeric_limits<float>::max();
+        }
+        return meshDistance(id, diff, closest, faceNormal, normal);
+    }
+    else {
+        float distance;
+        glm::vec3 gradient;
+        if (!sdfs[id]->sample(diff, distance, gradient)) {
+            return std::numeric_limits<float>::max();
+        }
+
+        float length = glm::length(gradient);
+        normal = length > 0.0001f ? gradient / length : glm::vec3(0.0f, 1.0f, 0.0f);
+        return distance - radii[id];
+    }
+}
+
+float ColliderSet::meshDistance(uint32_t id, const glm::vec3& diff, const glm::vec3& closest, const glm::vec3& faceNormal, glm::vec3& normal) const {
+    glm::vec3 offset = diff - closest;
+    float distance = glm::length(offset);
+    float side = glm::dot(offset, faceNormal) < 0.0f ? -1.0f : 1.0f;
+    normal = distance > 0.0001f ? offset * (side / distance) : faceNormal;
+    return side * distance - radii[id];
+}
+
+float ColliderSet::signedDistance(uint32_t id, const glm::vec3& p, glm::vec3& normal) const {
+    glm::vec3 diff = p - centers[id];
+
+    switch (types[id]) {
+    case COLLIDERTYPE::SPHERE:
+        return shapeDistance<COLLIDERTYPE::SPHERE>(id, diff, normal);
+    case COLLIDERTYPE::CAPSULE:
+        return shapeDistance<COLLIDERTYPE::CAPSULE>(id, diff, normal);
+    case COLLIDERTYPE::BOX:
+        return shapeDistance<COLLIDERTYPE::BOX>(id, diff, normal);
+    case COLLIDERTYPE::PLANE:
+        return shapeDistance<COLLIDERTYPE::PLANE>(id, diff, normal);
+    case COLLIDERTYPE::MESH:
+        return shapeDistance<COLLIDERTYPE::MESH>(id, diff, normal);
+    case COLLIDERTYPE::SDF:
+        return shapeDistance<COLLIDERTYPE::SDF>(id, diff, normal);
+    default:
+        normal = glm::vec3(0.0f, 1.0f, 0.0f);
+        return 0.0f;
+    }
+}
+
+void ColliderSet::collideWith(uint32_t id, ParticleStore& particles, size_t i) const {
+    glm::vec3 normal;
+    float distance = signedDistance(id, particles.positions[i], normal);
+
+    if (distance < margins[id]) {
+        resolveContact(particles, i, normal, -distance);
+    }
+}
+
+template <COLLIDERTYPE Type>
+void ColliderSet::collideSingle(ParticleStore& particles, size_t begin, size_t end) const {
+    // The only collider is id 0; a bounded one is item 0 of the bounds too
+    const glm::vec3 center = centers[0];
+    const float margin = margins[0];
+    const glm::vec3 lo = Type == COLLIDERTYPE::PLANE ? glm::vec3(0.0f) : boundsLo[0];
+    const glm::vec3 hi = Type == COLLIDERTYPE::PLANE ? glm::vec3(0.0f) : boundsHi[0];
+
+    for (size_t i = begin; i < end; ++i) {
+        if (particles.isPinned(i)) continue;
+
+        const glm::vec3 p = particles.positions[i];
+        if constexpr (Type != COLLIDERTYPE::PLANE) {
+            if (p.x < lo.x || p.y < lo.y || p.z < lo.z || p.x > hi.x || p.y > hi.y || p.z > hi.z) continue;
+        }
+
+        glm::vec3 normal;
+        float distance = shapeDistance<Type>(0, p - center, normal);
+        if (distance < margin) {
+            resolveContact(particles, i, normal, -distance);
+        }
+    }
+}
+
+void ColliderSet::collideMesh(ParticleStore& particles, size_t begin, size_t end) const {
+    const glm::vec3 center = centers[0];
+    const float margin = margins[0];
+    const float reach = radii[0] + margins[0] + MESH_SEARCH_DEPTH;
+    const glm::vec3 lo = boundsLo[0];
+    const glm::vec3 hi = boundsHi[0];
+
+    // Consecutive particles are neighbours in the cloth, so a batch of them
+    // shares most of its walk through the BVH. Each contact only moves its
+    // own particle, so querying the batch up front changes nothing.
+    uint32_t indices[MESH_QUERY_BATCH];
+    glm::vec3 diffs[MESH_QUERY_BATCH];
+    glm::vec3 closest[MESH_QUERY_BATCH];
+    glm::vec3 faceNormals[MESH_QUERY_BATCH];
+    bool found[MESH_QUERY_BATCH];
+
+    size_t i = begin;
+    while (i < end) {
+        uint32_t count = 0;
+        for (; i < end && count < MESH_QUERY_BATCH; ++i) {
+            if (particles.isPinned(i)) continue;
+
+            const glm::vec3 p = particles.positions[i];
+            if (p.x < lo.x || p.y < lo.y || p.z < lo.z || p.x > hi.x || p.y > hi.y || p.z > hi.z) continue;
+
+            indices[count] = static_cast<uint32_t>(i);
+            diffs[count] = p - center;
+            ++count;
+        }
+
+        meshes[0]->closestPoints(diffs, count, reach, closest, faceNormals, found);
+        for (uint32_t j = 0; j < count; ++j) {
+            if (!found[j]) continue;
+
+            glm::vec3 normal;
+            float distance = meshDistance(0, diffs[j], closest[j], faceNormals[j], normal);
+            if (distance < margin) {
+                resolveContact(particles, indices[j], normal, -distance);
+            }
+        }
+    }
+}
+
+void ColliderSet::collide(ParticleStore& particles, size_t begin, size_t end) const {
+    // Every mode has a single collider; its shape is picked once per range
+    // instead of per particle, and there's no BVH to walk
+    if (types.size() == 1) {
+        switch (types[0]) {
+        case COLLIDERTYPE::SPHERE:
+            collideSingle<COLLIDERTYPE::SPHERE>(particles, begin, end);
+            return;
+        case COLLIDERTYPE::CAPSULE:
+            collideSingle<COLLIDERTYPE::CAPSULE>(particles, begin, end);
+            return;
+        case COLLIDERTYPE::BOX:
+            collideSingle<COLLIDERTYPE::BOX>(particles, begin, end);
+            return;
+        case COLLIDERTYPE::PLANE:
+            collideSingle<COLLIDERTYPE::PLANE>(particles, begin, end);
+            return;
+        case COLLIDERTYPE::MESH:
+            collideMesh(particles, begin, end);
+            return;
+        case COLLIDERTYPE::SDF:
+            collideSingle<COLLIDERTYPE::SDF>(particles, begin, end);
+            return;
+        default:
+            break;
+        }
+    }
+
+    for (size_t i = begin; i < end; ++i) {
+        if (particles.isPinned(i)) continue;
+
+        // Contacts move the particle, so query where it was
+        glm::vec3 p = particles.positions[i];
+        bvh.forEachContaining(p, [&](uint32_t item) {
+            collideWith(bounded[item], particles, i);
+        });
+
+        for (uint32_t id : planes) {
+            collideWith(id, particles, i);
+        }
+    }
+}
+
+float ColliderSet::sweepDistance(uint32_t id, const glm::vec3& p) const {
+    glm::vec3 normal;
+    float distance = signedDistance(id, p, normal);
+    if (distance != std::numeric_limits<float>::max()) return distance;
+
+    switch (types[id]) {
+    case COLLIDERTYPE::MESH:
+        // No triangle within the search reach
+        return margins[id] + MESH_SEARCH_DEPTH;
+
+    case COLLIDERTYPE::SDF:
+    {
+        // Outside the grid; the surface is somewhere inside it
+        glm::vec3 local = p - centers[id];
+        glm::vec3 outside = glm::max(glm::max(sdfs[id]->getBoundsMin() - local, local - sdfs[id]->getBoundsMax()), glm::vec3(0.0f));
+        return glm::length(outside);
+    }
+
+    default:
+        return distance;
+    }
+}
+
+float ColliderSet::timeOfImpact(uint32_t id, const glm::vec3& from, const glm::vec3& delta, float length) const {
+    // Already in contact at the start is the discrete pass's business
+    float distance = sweepDistance(id, from);
+    if (distance < margins[id] + CCD_TOLERANCE) return 2.0f;
+
+    // Conservative advancement: nothing is closer than the distance to the
+    // surface, so the particle can move that far without crossing it
+    float t = 0.0f;
+    for (int k = 0; k < CCD_MAX_STEPS; ++k) {
+        t += distance / length;
+        if (t > 1.0f) return t;
+
+        distance = sweepDistance(id, from + delta * t);
+        if (distance <= CCD_TOLERANCE) return t;
+    }
+    return 2.0f;
+}
+
+void ColliderSet::sweep(ParticleStore& particles, size_t begin, size_t end) const {
+    for (size_t i = begin; i < end; ++i) {
+        if (particles.isPinned(i)) continue;
+
+        glm::vec3 from = particles.prevPositions[i];
+        glm::vec3 delta = particles.positions[i] - from;
+        float length = glm::length(delta);
+        if (length < CCD_TOLERANCE) continue;
+
+        float firstImpact = 1.0f;
+        int64_t hit = -1;
+        auto test = [&](uint32_t id) {
+            float t = timeOfImpact(id, from, delta, length);
+            if (t <= firstImpact) {
+                firstImpact = t;
+                hit = id;
+            }
+        };
+
+        bvh.forEachOverlapping(glm::min(from, particles.positions[i]), glm::max(from, particles.positions[i]), [&](uint32_t item) {
+            test(bounded[item]);
+        });
+        for (uint32_t id : planes) {
+            test(id);
+        }
+
+        if (hit < 0) continue;
+
+        glm::vec3 contact = from + delta * firstImpact;
+        glm::vec3 normal;
+        signedDistance(static_cast<uint32_t>(hit), contact, normal);
+
+        // Moving away from the surface, or along it, is no impact
+        if (glm::dot(delta, normal) >= 0.0f) continue;
+
+        // Keep the tangential part of what's left of the move
+        glm::vec3 rest = delta * (1.0f - firstImpact);
+        particles.positions[i] = contact + rest - normal * glm::dot(rest, normal);
+        resolveContact(particles, i, normal, 0.0f);
+    }
+}
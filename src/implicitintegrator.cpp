@@ -0,0 +1,268 @@
+#include "implicitintegrator.hpp"
+#include <algorithm>
+#include <cmath>
+
+ImplicitIntegrator::ImplicitIntegrator()
+    : maxIterations(64)
+    , tolerance(1e-3f)
+    , particles(nullptr)
+    , springs(nullptr)
+    , dt(1.0f / 60.0f)
+    , gravity(0.0f)
+    , alpha(0.0f)
+    , beta(0.0f)
+    , iterations(0)
+    , residual(0.0f)
+{
+}
+
+void ImplicitIntegrator::prepare(ParticleStore& particleStore, const SpringBuffer* springBuffer, float stepDt) {
+    particles = &particleStore;
+    springs = springBuffer;
+    dt = stepDt;
+
+    const size_t count = particles->size();
+    if (deltaV.size() != count) {
+        deltaV.assign(count, glm::vec3(0.0f));
+    }
+    velocities.resize(count);
+    startPositions.assign(particles->positions.begin(), particles->positions.end());
+    rhs.resize(count);
+    residuals.resize(count);
+    preconditioned.resize(count);
+    directions.resize(count);
+    products.resize(count);
+    inverseDiagonal.resize(count);
+    partials.resize((count + IMPLICIT_GRAIN - 1) / IMPLICIT_GRAIN);
+    blocks.resize(springs ? springs->size() : 0);
+
+    // Setup: spring blocks -> right hand side and preconditioner -> A dv
+    // for the warm start
+    setupGraph.clear();
+    TaskGraph::TaskId computed = setupGraph.addParallelFor(blocks.size(), IMPLICIT_GRAIN, [this](size_t begin, size_t end) {
+        computeBlocks(begin, end);
+    });
+    TaskGraph::TaskId assembled = setupGraph.addParallelFor(count, IMPLICIT_GRAIN, [this](size_t begin, size_t end) {
+        assemble(begin, end);
+    });
+    setupGraph.precede(computed, assembled);
+    TaskGraph::TaskId warm = setupGraph.addParallelFor(count, IMPLICIT_GRAIN, [this](size_t begin, size_t end) {
+        multiply(begin, end);
+    });
+    setupGraph.precede(assembled, warm);
+
+    // r = b - A dv, z = P r, p = z
+    startGraph.clear();
+    startGraph.addParallelFor(count, IMPLICIT_GRAIN, [this](size_t begin, size_t end) {
+        Partial sums{};
+        for (size_t i = begin; i < end; ++i) {
+            residuals[i] = rhs[i] - products[i];
+            preconditioned[i] = inverseDiagonal[i] * residuals[i];
+            directions[i] = preconditioned[i];
+            sums.first += glm::dot(residuals[i], preconditioned[i]);
+            sums.second += glm::dot(residuals[i], residuals[i]);
+            sums.third += glm::dot(rhs[i], rhs[i]);
+        }
+        partials[begin / IMPLICIT_GRAIN] = sums;
+    });
+
+    // q = A p
+    multiplyGraph.clear();
+    multiplyGraph.addParallelFor(count, IMPLICIT_GRAIN, [this](size_t begin, size_t end) {
+        multiply(begin, end);
+    });
+
+    // dv += alpha p, r -= alpha q, z = P r
+    updateGraph.clear();
+    updateGraph.addParallelFor(count, IMPLICIT_GRAIN, [this](size_t begin, size_t end) {
+        Partial sums{};
+        for (size_t i = begin; i < end; ++i) {
+            deltaV[i] += alpha * directions[i];
+            residuals[i] -= alpha * products[i];
+            preconditioned[i] = inverseDiagonal[i] * residuals[i];
+            sums.first += glm::dot(residuals[i], preconditioned[i]);
+            sums.second += glm::dot(residuals[i], residuals[i]);
+        }
+        partials[begin / IMPLICIT_GRAIN] = sums;
+    });
+
+    // p = z + beta p
+    directionGraph.clear();
+    directionGraph.addParallelFor(count, IMPLICIT_GRAIN, [this](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            directions[i] = preconditioned[i] + beta * directions[i];
+        }
+    });
+
+    // x += h (v + dv), with the old position becoming the previous one
+    finishGraph.clear();
+    finishGraph.addParallelFor(count, IMPLICIT_GRAIN, [this](size_t begin, size_t end) {
+        glm::vec3* positions = particles->positions.data();
+        glm::vec3* prevPositions = particles->prevPositions.data();
+        for (size_t i = begin; i < end; ++i) {
+            startPositions[i] = positions[i];
+            if (particles->invMass[i] != 0.0f) {
+                prevPositions[i] = positions[i];
+                positions[i] += (velocities[i] + deltaV[i]) * dt;
+            }
+            particles->forces[i] = glm::vec3(0.0f);
+        }
+    });
+}
+
+void ImplicitIntegrator::step(JobSystem& jobs, const glm::vec3& stepGravity) {
+    gravity = stepGravity;
+
+    jobs.run(setupGraph);
+    jobs.run(startGraph);
+
+    Partial sums = sumPartials();
+    float rz = sums.first;
+    float rr = sums.second;
+    const float rhsNormSq = std::max(sums.third, 1e-20f);
+    const float target = tolerance * tolerance * rhsNormSq;
+
+    iterations = 0;
+    while (iterations < maxIterations && rr > target) {
+        jobs.run(multiplyGraph);
+        float pq = sumPartials().first;
+        if (pq <= 0.0f) break;
+
+        alpha = rz / pq;
+        jobs.run(updateGraph);
+        ++iterations;
+
+        sums = sumPartials();
+        rr = sums.second;
+        if (rr <= target) break;
+
+        beta = sums.first / rz;
+        rz = sums.first;
+        jobs.run(directionGraph);
+    }
+    residual = std::sqrt(rr / rhsNormSq);
+
+    jobs.run(finishGraph);
+}
+
+void ImplicitIntegrator::computeBlocks(size_t begin, size_t end) {
+    const glm::vec3* positions = particles->positions.data();
+    const glm::vec3* prevPositions = particles->prevPositions.data();
+    const float invDt = 1.0f / dt;
+
+    for (size_t i = begin; i < end; ++i) {
+        const Spring& s = (*springs)[i];
+        SpringBlock& block = blocks[i];
+        block = SpringBlock{ glm::mat3(0.0f), glm::vec3(0.0f), 0.0f, glm::vec3(0.0f) };
+        if (!s.active) continue;
+
+        glm::vec3 delta = positions[s.p2] - positions[s.p1];
+        float currentLength = glm::length(delta);
+        if (currentLength == 0.0f) continue;
+
+        const SpringMaterial& mat = springs->material(s.type);
+        glm::vec3 direction = delta / currentLength;
+
+        // Same stiffening past 10% stretch as the explicit kernels
+        float stretchRatio = currentLength * s.invRestLength;
+        float stiffness = mat.stiffness;
+        if (stretchRatio > 1.1f) {
+            stiffness *= stretchRatio * stretchRatio * stretchRatio;
+        }
+
+        // The explicit kernels damp by the displacement over a step, which
+        // the materials are scaled for; over dt that's this much per m/s
+        float dampingCoeff = mat.damping * dt;
+        glm::vec3 relativeVelocity = ((positions[s.p2] - prevPositions[s.p2]) - (positions[s.p1] - prevPositions[s.p1])) * invDt;
+
+        block.force = stiffness * (currentLength - s.restLength) * direction
+            + dampingCoeff * glm::dot(relativeVelocity, direction) * direction;
+
+        // A compressed spring has no transverse stiffness; dropping it keeps
+        // the matrix positive definite for CG
+        glm::mat3 along = glm::outerProduct(direction, direction);
+        float transverse = std::max(1.0f - s.restLength / currentLength, 0.0f);
+        block.stiffness = (dt * dt * stiffness) * (along + transverse * (glm::mat3(1.0f) - along));
+        block.direction = direction;
+        block.damping = dt * dampingCoeff;
+    }
+}
+
+void ImplicitIntegrator::assemble(size_t begin, size_t end) {
+    const glm::vec3* positions = particles->positions.data();
+    const glm::vec3* prevPositions = particles->prevPositions.data();
+    const float invDt = 1.0f / dt;
+
+    for (size_t i = begin; i < end; ++i) {
+        velocities[i] = (positions[i] - prevPositions[i]) * invDt;
+
+        const float invMass = particles->invMass[i];
+        if (invMass == 0.0f) {
+            rhs[i] = glm::vec3(0.0f);
+            deltaV[i] = glm::vec3(0.0f);
+            directions[i] = glm::vec3(0.0f);
+            inverseDiagonal[i] = glm::mat3(0.0f);
+            continue;
+        }
+
+        const float mass = 1.0f / invMass;
+        glm::vec3 force = particles->forces[i] + mass * gravity;
+        glm::vec3 stiffnessTerm(0.0f);
+        glm::mat3 diagonal(mass);
+
+        if (springs) {
+            for (uint32_t index : springs->springsOf(static_cast<uint32_t>(i))) {
+                const Spring& s = (*springs)[index];
+                const SpringBlock& block = blocks[index];
+                bool first = s.p1 == i;
+                uint32_t other = first ? s.p2 : s.p1;
+
+                force += first ? block.force : -block.force;
+                glm::vec3 otherVelocity = (positions[other] - prevPositions[other]) * invDt;
+                stiffnessTerm += block.stiffness * (velocities[i] - otherVelocity);
+                diagonal += block.stiffness + block.damping * glm::outerProduct(block.direction, block.direction);
+            }
+        }
+
+        rhs[i] = dt * force - stiffnessTerm;
+        inverseDiagonal[i] = glm::inverse(diagonal);
+        directions[i] = deltaV[i];
+    }
+}
+
+void ImplicitIntegrator::multiply(size_t begin, size_t end) {
+    float pq = 0.0f;
+    for (size_t i = begin; i < end; ++i) {
+        const float invMass = particles->invMass[i];
+        if (invMass == 0.0f) {
+            products[i] = glm::vec3(0.0f);
+            continue;
+        }
+
+        glm::vec3 result = directions[i] / invMass;
+        if (springs) {
+            for (uint32_t index : springs->springsOf(static_cast<uint32_t>(i))) {
+                const Spring& s = (*springs)[index];
+                const SpringBlock& block = blocks[index];
+                uint32_t other = s.p1 == i ? s.p2 : s.p1;
+
+                glm::vec3 difference = directions[i] - directions[other];
+                result += block.stiffness * difference + block.damping * glm::dot(block.direction, difference) * block.direction;
+            }
+        }
+
+        products[i] = result;
+        pq += glm::dot(directions[i], result);
+    }
+    partials[begin / IMPLICIT_GRAIN].first = pq;
+}
+
+ImplicitIntegrator::Partial ImplicitIntegrator::sumPartials() const {
+    Partial total{};
+    for (const Partial& partial : partials) {
+        total.first += partial.first;
+        total.second += partial.second;
+        total.third += partial.third;
+    }
+    return total;
+}
@@ -0,0 +1,231 @@
+#include "iterationaccelerator.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+IterationAccelerator::IterationAccelerator()
+    : mode(ACCELERATION::NONE)
+    , spectralRadius(0.95f)
+    , underRelaxation(0.9f)
+    , delay(2)
+    , window(4)
+    , count(0)
+    , current(0)
+    , iteration(-1)
+    , omega(1.0f)
+    , coefficients{}
+    , history(0)
+    , newest(0)
+    , previousResidualSq(0.0)
+{
+}
+
+void IterationAccelerator::prepare(size_t particleCount) {
+    count = particleCount;
+    window = std::clamp(window, 1, MAX_ANDERSON_WINDOW);
+    for (AlignedVector<glm::vec3>& start : starts) {
+        start.resize(count);
+    }
+
+    // The history is only worth its memory when Anderson runs
+    const size_t historySize = mode == ACCELERATION::ANDERSON ? count : 0;
+    lastResidual.resize(historySize);
+    lastResult.resize(historySize);
+    for (int slot = 0; slot < MAX_ANDERSON_WINDOW; ++slot) {
+        residualDifferences[slot].resize(slot < window ? historySize : 0);
+        resultDifferences[slot].resize(slot < window ? historySize : 0);
+    }
+    partials.resize((count + ACCELERATION_GRAIN - 1) / ACCELERATION_GRAIN);
+}
+
+void IterationAccelerator::begin() {
+    iteration = -1;
+    omega = 1.0f;
+    history = 0;
+    newest = window - 1;
+    previousResidualSq = std::numeric_limits<double>::infinity();
+}
+
+void IterationAccelerator::next() {
+    ++iteration;
+    current = 1 - current;
+
+    // The Chebyshev weights start over after the delay; the first
+    // extrapolating iteration needs one plain one before it
+    const float rhoSq = spectralRadius * spectralRadius;
+    if (iteration < std::max(delay, 1)) {
+        omega = 1.0f;
+    }
+    else if (iteration == std::max(delay, 1)) {
+        omega = 2.0f / (2.0f - rhoSq);
+    }
+    else {
+        omega = 4.0f / (4.0f - rhoSq * omega);
+    }
+
+    // Every iteration after the first adds a difference to the history
+    if (iteration > 0) {
+        newest = (newest + 1) % window;
+        history = std::min(history + 1, window);
+    }
+}
+
+TaskGraph::TaskId IterationAccelerator::addStartTasks(TaskGraph& graph, ParticleStore& particles, TaskGraph::TaskId after) {
+    TaskGraph::TaskId kept = graph.addParallelFor(count, ACCELERATION_GRAIN, [this, &particles](size_t begin, size_t end) {
+        std::copy(particles.positions.begin() + begin, particles.positions.begin() + end, starts[current].begin() + begin);
+    });
+    graph.precede(after, kept);
+    return kept;
+}
+
+TaskGraph::TaskId IterationAccelerator::addTasks(TaskGraph& graph, ParticleStore& particles, TaskGraph::TaskId after) {
+    if (mode == ACCELERATION::CHEBYSHEV) {
+        TaskGraph::TaskId extrapolated = graph.addParallelFor(count, ACCELERATION_GRAIN, [this, &particles](size_t begin, size_t end) {
+            chebyshev(particles, begin, end);
+        });
+        graph.precede(after, extrapolated);
+        return extrapolated;
+    }
+
+    // Anderson: differences and their dot products -> the small least
+    // squares problem -> the mix
+    TaskGraph::TaskId differenced = graph.addParallelFor(count, ACCELERATION_GRAIN, [this, &particles](size_t begin, size_t end) {
+        differences(particles, begin, end);
+    });
+    graph.precede(after, differenced);
+
+    TaskGraph::TaskId solved = graph.add([this] {
+        solveCoefficients();
+    });
+    graph.precede(differenced, solved);
+
+    TaskGraph::TaskId mixed = graph.addParallelFor(count, ACCELERATION_GRAIN, [this, &particles](size_t begin, size_t end) {
+        mix(particles, begin, end);
+    });
+    graph.precede(solved, mixed);
+    return mixed;
+}
+
+void IterationAccelerator::chebyshev(ParticleStore& particles, size_t begin, size_t end) const {
+    const glm::vec3* start = starts[current].data();
+    const glm::vec3* previous = starts[1 - current].data();
+    const bool extrapolate = omega != 1.0f;
+
+    for (size_t i = begin; i < end; ++i) {
+        if (particles.invMass[i] == 0.0f) continue;
+
+        glm::vec3 result = start[i] + underRelaxation * (particles.positions[i] - start[i]);
+        if (extrapolate) {
+            result = previous[i] + omega * (result - previous[i]);
+        }
+        particles.positions[i] = result;
+    }
+}
+
+void IterationAccelerator::differences(ParticleStore& particles, size_t begin, size_t end) {
+    const glm::vec3* start = starts[current].data();
+    Partial& partial = partials[begin / ACCELERATION_GRAIN];
+    partial.gram.fill(0.0);
+    partial.projected.fill(0.0);
+    partial.residualSq = 0.0;
+
+    for (size_t i = begin; i < end; ++i) {
+        const glm::vec3 result = particles.positions[i];
+        const glm::vec3 residual = result - start[i];
+        if (iteration > 0) {
+            residualDifferences[newest][i] = residual - lastResidual[i];
+            resultDifferences[newest][i] = result - lastResult[i];
+        }
+        lastResidual[i] = residual;
+        lastResult[i] = result;
+
+        partial.residualSq += glm::dot(residual, residual);
+        for (int a = 0; a < history; ++a) {
+            const glm::vec3& da = residualDifferences[a][i];
+            partial.projected[a] += glm::dot(da, residual);
+            for (int b = 0; b <= a; ++b) {
+                partial.gram[a * MAX_ANDERSON_WINDOW + b] += glm::dot(da, residualDifferences[b][i]);
+            }
+        }
+    }
+}
+
+void IterationAccelerator::solveCoefficients() {
+    Partial total{};
+    for (const Partial& partial : partials) {
+        total.residualSq += partial.residualSq;
+        for (int a = 0; a < history; ++a) {
+            total.projected[a] += partial.projected[a];
+            for (int b = 0; b <= a; ++b) {
+                total.gram[a * MAX_ANDERSON_WINDOW + b] += partial.gram[a * MAX_ANDERSON_WINDOW + b];
+            }
+        }
+    }
+
+    // A growing residual means the mix overshot; start over from this
+    // iteration's plain result
+    if (total.residualSq > previousResidualSq) {
+        history = 0;
+        newest = window - 1;
+    }
+    previousResidualSq = total.residualSq;
+
+    // Regularised normal equations, solved by Cholesky in place
+    const int m = history;
+    double trace = 0.0;
+    for (int a = 0; a < m; ++a) {
+        trace += total.gram[a * MAX_ANDERSON_WINDOW + a];
+    }
+    const double regularisation = 1e-10 * trace + 1e-30;
+
+    std::array<double, MAX_ANDERSON_WINDOW * MAX_ANDERSON_WINDOW> l{};
+    std::array<double, MAX_ANDERSON_WINDOW> y{};
+    for (int a = 0; a < m; ++a) {
+        for (int b = 0; b <= a; ++b) {
+            double sum = total.gram[a * MAX_ANDERSON_WINDOW + b] + (a == b ? regularisation : 0.0);
+            for (int c = 0; c < b; ++c) {
+                sum -= l[a * MAX_ANDERSON_WINDOW + c] * l[b * MAX_ANDERSON_WINDOW + c];
+            }
+            if (a == b) {
+                if (sum <= 0.0) {
+                    history = 0;
+                    return;
+                }
+                l[a * MAX_ANDERSON_WINDOW + a] = std::sqrt(sum);
+            }
+            else {
+                l[a * MAX_ANDERSON_WINDOW + b] = sum / l[b * MAX_ANDERSON_WINDOW + b];
+            }
+        }
+    }
+    for (int a = 0; a < m; ++a) {
+        double sum = total.projected[a];
+        for (int c = 0; c < a; ++c) {
+            sum -= l[a * MAX_ANDERSON_WINDOW + c] * y[c];
+        }
+        y[a] = sum / l[a * MAX_ANDERSON_WINDOW + a];
+    }
+    std::array<double, MAX_ANDERSON_WINDOW> c{};
+    for (int a = m - 1; a >= 0; --a) {
+        double sum = y[a];
+        for (int k = a + 1; k < m; ++k) {
+            sum -= l[k * MAX_ANDERSON_WINDOW + a] * c[k];
+        }
+        c[a] = sum / l[a * MAX_ANDERSON_WINDOW + a];
+        coefficients[a] = static_cast<float>(c[a]);
+    }
+}
+
+void IterationAccelerator::mix(ParticleStore& particles, size_t begin, size_t end) const {
+    if (history == 0) return;
+
+    for (size_t i = begin; i < end; ++i) {
+        if (particles.invMass[i] == 0.0f) continue;
+
+        glm::vec3 result = particles.positions[i];
+        for (int a = 0; a < history; ++a) {
+            result -= coefficients[a] * resultDifferences[a][i];
+        }
+        particles.positions[i] = result;
+    }
+}
@@ -0,0 +1,264 @@
+#include "jobsystem.hpp"
+#include <algorithm>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#elif defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace
+{
+    // Lets a worker find its own queue when it submits nested work
+    thread_local const JobSystem* currentSystem = nullptr;
+    thread_local int currentWorker = -1;
+
+    void pinCurrentThread(unsigned core) {
+#if defined(_WIN32)
+        if (core < sizeof(DWORD_PTR) * 8) {
+            SetThreadAffinityMask(GetCurrentThread(), DWORD_PTR(1) << core);
+        }
+#elif defined(__linux__)
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(core, &set);
+        pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#else
+        (void)core;
+#endif
+    }
+}
+
+TaskGraph::TaskId TaskGraph::add(TaskFunction fn) {
+    return addParallelFor(1, 1, [task = std::move(fn)](size_t, size_t) { task(); });
+}
+
+TaskGraph::TaskId TaskGraph::addParallelFor(size_t count, size_t grain, RangeFunction fn) {
+    Node& node = nodes.emplace_back();
+    node.fn = std::move(fn);
+    node.count = count;
+    node.grain = std::max<size_t>(grain, 1);
+    node.chunks = (count + node.grain - 1) / node.grain;
+    return static_cast<TaskId>(nodes.size() - 1);
+}
+
+void TaskGraph::precede(TaskId before, TaskId after) {
+    if (before == NONE || after == NONE) return;
+    nodes[before].successors.push_back(after);
+    ++nodes[after].dependencies;
+}
+
+void TaskGraph::clear() {
+    nodes.clear();
+    pendingNodes.store(0, std::memory_order_relaxed);
+}
+
+JobSystem::JobSystem(unsigned workerCount, bool pinThreads)
+    : queuedJobs(0)
+    , stealCursor(0)
+    , stopping(false)
+    , pinned(pinThreads)
+{
+    unsigned hardware = std::max(std::thread::hardware_concurrency(), 1u);
+    if (workerCount == 0) {
+        workerCount = hardware - 1;
+    }
+
+    for (unsigned i = 0; i <= workerCount; ++i) {
+        queues.push_back(std::make_unique<WorkQueue>());
+    }
+
+    workers.reserve(workerCount);
+    for (unsigned i = 0; i < workerCount; ++i) {
+        workers.emplace_back([this, i, hardware] {
+            if (pinned) {
+                pinCurrentThread((i + 1) % hardware);
+            }
+            workerLoop(i);
+        });
+    }
+}
+
+JobSystem::~JobSystem() {
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        stopping = true;
+    }
+    sleepCondition.notify_all();
+
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+void JobSystem::submit(TaskGraph& graph) {
+    if (graph.nodes.empty()) return;
+
+    for (auto& node : graph.nodes) {
+        node.pendingDependencies.store(node.dependencies, std::memory_order_relaxed);
+        node.pendingChunks.store(node.chunks, std::memory_order_relaxed);
+    }
+    graph.pendingNodes.store(graph.nodes.size(), std::memory_order_release);
+
+    for (TaskGraph::TaskId id = 0; id < graph.nodes.size(); ++id) {
+        if (graph.nodes[id].dependencies == 0) {
+            scheduleNode(graph, id);
+        }
+    }
+}
+
+void JobSystem::wait(TaskGraph& graph) {
+    while (!graph.isDone()) {
+        Job job;
+        if (tryPop(job)) {
+            execute(job);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        sleepCondition.wait(lock, [&] {
+            return graph.isDone() || queuedJobs.load(std::memory_order_acquire) > 0;
+        });
+    }
+}
+
+void JobSystem::run(TaskGraph& graph) {
+    submit(graph);
+    wait(graph);
+}
+
+void JobSystem::parallelFor(size_t count, size_t grain, const RangeFunction& fn) {
+    if (count == 0) return;
+
+    // Not worth a round trip through the queues for a single chunk
+    if (workers.empty() || count <= std::max<size_t>(grain, 1)) {
+        fn(0, count);
+        return;
+    }
+
+    TaskGraph graph;
+    graph.addParallelFor(count, grain, [&fn](size_t begin, size_t end) { fn(begin, end); });
+    run(graph);
+}
+
+int JobSystem::currentQueue() const {
+    if (currentSystem == this && currentWorker >= 0) {
+        return currentWorker;
+    }
+    return static_cast<int>(queues.size() - 1);
+}
+
+bool JobSystem::tryPop(Job& job) {
+    int own = currentQueue();
+    // queues is complete before any worker starts, unlike workers
+    int injection = static_cast<int>(queues.size() - 1);
+
+    // Own queue from the back, newest work first
+    if (own != injection) {
+        WorkQueue& queue = *queues[own];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (!queue.jobs.empty()) {
+            job = queue.jobs.back();
+            queue.jobs.pop_back();
+            queuedJobs.fetch_sub(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+
+    // Injection queue, then steal the oldest work from the other workers
+    auto popFront = [&](int victim) {
+        WorkQueue& queue = *queues[victim];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.jobs.empty()) return false;
+        job = queue.jobs.front();
+        queue.jobs.pop_front();
+        queuedJobs.fetch_sub(1, std::memory_order_relaxed);
+        return true;
+    };
+
+    if (popFront(injection)) return true;
+
+    unsigned workerCount = static_cast<unsigned>(injection);
+    unsigned start = stealCursor.fetch_add(1, std::memory_order_relaxed);
+    for (unsigned i = 0; i < workerCount; ++i) {
+        int victim = static_cast<int>((start + i) % workerCount);
+        if (victim != own && popFront(victim)) return true;
+    }
+
+    return false;
+}
+
+void JobSystem::execute(const Job& job) {
+    TaskGraph& graph = *job.graph;
+    TaskGraph::Node& node = graph.nodes[job.node];
+
+    size_t begin = job.chunk * node.grain;
+    size_t end = std::min(begin + node.grain, node.count);
+    node.fn(begin, end);
+
+    if (node.pendingChunks.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        completeNode(graph, job.node);
+    }
+}
+
+void JobSystem::scheduleNode(TaskGraph& graph, TaskGraph::TaskId id) {
+    TaskGraph::Node& node = graph.nodes[id];
+
+    if (node.chunks == 0) {
+        completeNode(graph, id);
+        return;
+    }
+
+    WorkQueue& queue = *queues[currentQueue()];
+    {
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        for (size_t chunk = 0; chunk < node.chunks; ++chunk) {
+            queue.jobs.push_back({ &graph, id, chunk });
+        }
+        // Counted before the lock drops so a pop can never see the job uncounted
+        queuedJobs.fetch_add(node.chunks, std::memory_order_release);
+    }
+    wakeAll();
+}
+
+void JobSystem::completeNode(TaskGraph& graph, TaskGraph::TaskId id) {
+    for (TaskGraph::TaskId successor : graph.nodes[id].successors) {
+        if (graph.nodes[successor].pendingDependencies.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            scheduleNode(graph, successor);
+        }
+    }
+
+    // Successors are scheduled before this node stops counting as pending
+    if (graph.pendingNodes.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        wakeAll();
+    }
+}
+
+void JobSystem::wakeAll() {
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+    }
+    sleepCondition.notify_all();
+}
+
+void JobSystem::workerLoop(unsigned index) {
+    currentSystem = this;
+    currentWorker = static_cast<int>(index);
+
+    for (;;) {
+        Job job;
+        if (tryPop(job)) {
+            execute(job);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        sleepCondition.wait(lock, [this] {
+            return stopping || queuedJobs.load(std::memory_order_acquire) > 0;
+        });
+        if (stopping) return;
+    }
+}
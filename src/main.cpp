@@ -1,9 +1,101 @@
 ﻿#include <SDL3/SDL.h>
 #include <SDL3/SDL_main.h>
+#include <algorithm>
+#include <cstdlib>
+#include <string_view>
 #include "simulation.hpp"
 
+static SimulationConfig parseArguments(int argc, char* argv[]) {
+    SimulationConfig config;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string_view arg = argv[i];
+
+        if (arg == "--workers" && i + 1 < argc) {
+            config.workerCount = static_cast<unsigned>(std::max(std::atoi(argv[++i]), 0));
+        }
+        else if (arg == "--pin-threads") {
+            config.pinThreads = true;
+        }
+        else if (arg == "--solver" && i + 1 < argc) {
+            std::string_view solver = argv[++i];
+            if (solver == "jacobi") {
+                config.solver = SOLVERMODE::JACOBI;
+            }
+            else if (solver == "xpbd") {
+                config.solver = SOLVERMODE::XPBD;
+            }
+            else if (solver == "projective") {
+                config.solver = SOLVERMODE::PROJECTIVE;
+            }
+            else if (solver == "gauss-seidel") {
+                config.solver = SOLVERMODE::GAUSS_SEIDEL;
+            }
+            else {
+                SDL_Log("Unknown solver: %s", argv[i]);
+            }
+        }
+        else if (arg == "--relaxation" && i + 1 < argc) {
+            config.jacobiRelaxation = std::clamp(static_cast<float>(std::atof(argv[++i])), 1.0f, 2.0f);
+        }
+        else if (arg == "--tolerance" && i + 1 < argc) {
+            config.residualTolerance = std::max(static_cast<float>(std::atof(argv[++i])), 0.0f);
+        }
+        else if (arg == "--min-iterations" && i + 1 < argc) {
+            config.minIterations = std::max(std::atoi(argv[++i]), 1);
+        }
+        else if (arg == "--max-iterations" && i + 1 < argc) {
+            config.maxIterations = std::max(std::atoi(argv[++i]), 1);
+        }
+        else if (arg == "--substeps" && i + 1 < argc) {
+            config.substeps = std::max(std::atoi(argv[++i]), 0);
+        }
+        else if (arg == "--implicit" && i + 1 < argc) {
+            config.implicitScale = std::max(std::atoi(argv[++i]), 0);
+        }
+        else if (arg == "--multigrid") {
+            config.multigrid = true;
+        }
+        else if (arg == "--acceleration" && i + 1 < argc) {
+            std::string_view acceleration = argv[++i];
+            if (acceleration == "chebyshev") {
+                config.acceleration = ACCELERATION::CHEBYSHEV;
+            }
+            else if (acceleration == "anderson") {
+                config.acceleration = ACCELERATION::ANDERSON;
+            }
+            else if (acceleration == "none") {
+                config.acceleration = ACCELERATION::NONE;
+            }
+            else {
+                SDL_Log("Unknown acceleration: %s", argv[i]);
+            }
+        }
+        else if (arg == "--wind-seed" && i + 1 < argc) {
+            config.windSeed = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        }
+        else if (arg == "--rows" && i + 1 < argc) {
+            config.rows = std::atoi(argv[++i]);
+        }
+        else if (arg == "--cols" && i + 1 < argc) {
+            config.cols = std::atoi(argv[++i]);
+        }
+        else if (arg == "--spacing" && i + 1 < argc) {
+            config.spacing = static_cast<float>(std::atof(argv[++i]));
+        }
+        else if (arg == "--no-sleep") {
+            config.sleeping = false;
+        }
+        else {
+            SDL_Log("Ignoring unknown argument: %s", argv[i]);
+        }
+    }
+
+    return config;
+}
+
 int main(int argc, char* argv[]) {
-    Simulation simulation = Simulation();
+    Simulation simulation(parseArguments(argc, argv));
 
     if (!simulation.init()) {
         SDL_Log("Error Initializing\n");
@@ -0,0 +1,189 @@
+#include "meshcollider.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <utility>
+
+namespace
+{
+    // Closest point on triangle (a, a + ab, a + ac) to p, by Voronoi region
+    glm::vec3 closestOnTriangle(const glm::vec3& p, const glm::vec3& a, const glm::vec3& ab, const glm::vec3& ac) {
+        glm::vec3 ap = p - a;
+        float d1 = glm::dot(ab, ap);
+        float d2 = glm::dot(ac, ap);
+        if (d1 <= 0.0f && d2 <= 0.0f) return a;
+
+        glm::vec3 bp = ap - ab;
+        float d3 = glm::dot(ab, bp);
+        float d4 = glm::dot(ac, bp);
+        if (d3 >= 0.0f && d4 <= d3) return a + ab;
+
+        float vc = d1 * d4 - d3 * d2;
+        if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f) {
+            return a + ab * (d1 / (d1 - d3));
+        }
+
+        glm::vec3 cp = ap - ac;
+        float d5 = glm::dot(ab, cp);
+        float d6 = glm::dot(ac, cp);
+        if (d6 >= 0.0f && d5 <= d6) return a + ac;
+
+        float vb = d5 * d2 - d1 * d6;
+        if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f) {
+            return a + ac * (d2 / (d2 - d6));
+        }
+
+        float va = d3 * d6 - d5 * d4;
+        if (va <= 0.0f && (d4 - d3) >= 0.0f && (d5 - d6) >= 0.0f) {
+            float w = (d4 - d3) / ((d4 - d3) + (d5 - d6));
+            return a + ab + (ac - ab) * w;
+        }
+
+        float denom = 1.0f / (va + vb + vc);
+        return a + ab * (vb * denom) + ac * (vc * denom);
+    }
+}
+
+void MeshCollider::build(const std::vector<PoleVertex>& soup, const glm::vec3& scale) {
+    std::vector<glm::vec3> points;
+    std::vector<uint32_t> order;
+    points.reserve(soup.size());
+    order.reserve(soup.size());
+
+    for (size_t i = 0; i + 2 < soup.size(); i += 3) {
+        glm::vec3 a = soup[i].position * scale;
+        glm::vec3 b = soup[i + 1].position * scale;
+        glm::vec3 c = soup[i + 2].position * scale;
+
+        // Wind the triangle so its face normal agrees with the vertex normals
+        glm::vec3 faceNormal = glm::cross(b - a, c - a);
+        glm::vec3 vertexNormal = soup[i].normal + soup[i + 1].normal + soup[i + 2].normal;
+        if (glm::dot(faceNormal, vertexNormal) < 0.0f) {
+            std::swap(b, c);
+        }
+
+        uint32_t first = static_cast<uint32_t>(points.size());
+        points.push_back(a);
+        points.push_back(b);
+        points.push_back(c);
+        order.push_back(first);
+        order.push_back(first + 1);
+        order.push_back(first + 2);
+    }
+
+    build(points, order);
+}
+
+void MeshCollider::build(std::span<const glm::vec3> meshVertices, std::span<const uint32_t> meshIndices) {
+    vertices.assign(meshVertices.begin(), meshVertices.end());
+    indices.clear();
+    indices.reserve(meshIndices.size());
+
+    // Zero-area triangles have no normal and are covered by their neighbours
+    for (size_t i = 0; i + 2 < meshIndices.size(); i += 3) {
+        const glm::vec3& a = vertices[meshIndices[i]];
+        glm::vec3 n = glm::cross(vertices[meshIndices[i + 1]] - a, vertices[meshIndices[i + 2]] - a);
+        if (glm::dot(n, n) <= 1e-12f) continue;
+
+        indices.insert(indices.end(), meshIndices.begin() + i, meshIndices.begin() + i + 3);
+    }
+
+    triangles.resize(triangleCount());
+    triangleMin.resize(triangleCount());
+    triangleMax.resize(triangleCount());
+    updateTriangles();
+
+    bvh.build(triangleMin.data(), triangleMax.data(), triangleCount());
+}
+
+void MeshCollider::updateVertices(std::span<const glm::vec3> meshVertices) {
+    vertices.assign(meshVertices.begin(), meshVertices.end());
+    updateTriangles();
+    bvh.refit(triangleMin.data(), triangleMax.data());
+}
+
+void MeshCollider::updateTriangles() {
+    boundsMin = glm::vec3(std::numeric_limits<float>::max());
+    boundsMax = glm::vec3(-std::numeric_limits<float>::max());
+
+    for (size_t t = 0; t < triangleCount(); ++t) {
+        const glm::vec3& a = vertices[indices[3 * t]];
+        const glm::vec3& b = vertices[indices[3 * t + 1]];
+        const glm::vec3& c = vertices[indices[3 * t + 2]];
+
+        Triangle& tri = triangles[t];
+        tri.a = a;
+        tri.ab = b - a;
+        tri.ac = c - a;
+
+        // A triangle that collapsed since the build keeps a zero normal and
+        // is skipped by queries
+        glm::vec3 n = glm::cross(tri.ab, tri.ac);
+        float lengthSq = glm::dot(n, n);
+        tri.normal = lengthSq > 1e-12f ? n / std::sqrt(lengthSq) : glm::vec3(0.0f);
+
+        triangleMin[t] = glm::min(a, glm::min(b, c));
+        triangleMax[t] = glm::max(a, glm::max(b, c));
+        boundsMin = glm::min(boundsMin, triangleMin[t]);
+        boundsMax = glm::max(boundsMax, triangleMax[t]);
+    }
+
+    if (triangleCount() == 0) {
+        boundsMin = boundsMax = glm::vec3(0.0f);
+    }
+}
+
+bool MeshCollider::closestPoint(const glm::vec3& p, float maxDistance, glm::vec3& closest, glm::vec3& normal) const {
+    int64_t best = bvh.findNearest(p, maxDistance * maxDistance, [&](uint32_t t) {
+        const Triangle& tri = triangles[t];
+        if (tri.normal == glm::vec3(0.0f)) return std::numeric_limits<float>::max();
+
+        glm::vec3 d = p - closestOnTriangle(p, tri.a, tri.ab, tri.ac);
+        return glm::dot(d, d);
+    });
+
+    if (best < 0) return false;
+
+    const Triangle& tri = triangles[best];
+    closest = closestOnTriangle(p, tri.a, tri.ab, tri.ac);
+    normal = tri.normal;
+    return true;
+}
+
+void MeshCollider::closestPoints(const glm::vec3* points, uint32_t count, float maxDistance, glm::vec3* closest, glm::vec3* normals, bool* found) const {
+    float bestSq[MESH_QUERY_BATCH];
+    int64_t best[MESH_QUERY_BATCH];
+    count = std::min(count, MESH_QUERY_BATCH);
+    std::fill(bestSq, bestSq + count, maxDistance * maxDistance);
+
+    bvh.findNearestBatch(points, count, bestSq, best, [&](uint32_t j, uint32_t t) {
+        const Triangle& tri = triangles[t];
+        if (tri.normal == glm::vec3(0.0f)) return std::numeric_limits<float>::max();
+
+        glm::vec3 d = points[j] - closestOnTriangle(points[j], tri.a, tri.ab, tri.ac);
+        return glm::dot(d, d);
+    });
+
+    for (uint32_t j = 0; j < count; ++j) {
+        found[j] = best[j] >= 0;
+        if (!found[j]) continue;
+
+        const Triangle& tri = triangles[best[j]];
+        closest[j] = closestOnTriangle(points[j], tri.a, tri.ab, tri.ac);
+        normals[j] = tri.normal;
+    }
+}
+
+uint64_t MeshCollider::contentHash() const {
+    uint64_t hash = 14695981039346656037ull;
+    auto mix = [&hash](const void* data, size_t bytes) {
+        const unsigned char* p = static_cast<const unsigned char*>(data);
+        for (size_t i = 0; i < bytes; ++i) {
+            hash = (hash ^ p[i]) * 1099511628211ull;
+        }
+    };
+
+    mix(vertices.data(), vertices.size() * sizeof(glm::vec3));
+    mix(indices.data(), indices.size() * sizeof(uint32_t));
+    return hash;
+}
@@ -0,0 +1,218 @@
+#include "multigrid.hpp"
+#include <algorithm>
+
+Multigrid::Multigrid()
+    : smoothingSweeps(1)
+    , coarsestSweeps(4)
+{
+}
+
+void Multigrid::coarseLines(uint32_t count, std::vector<uint32_t>& lines) {
+    lines.clear();
+    for (uint32_t i = 0; i < count; i += 2) {
+        lines.push_back(i);
+    }
+    if (lines.back() != count - 1) {
+        lines.push_back(count - 1);
+    }
+}
+
+void Multigrid::build(const ParticleStore& particles, const SpringBuffer& springs, uint32_t rows, uint32_t cols, int maxLevels) {
+    levels.clear();
+    fineIntactSprings.clear();
+    if (static_cast<size_t>(rows) * cols != particles.size()) return;
+
+    fineIntactSprings.resize(particles.size());
+    for (uint32_t i = 0; i < particles.size(); ++i) {
+        fineIntactSprings[i] = static_cast<uint32_t>(springs.springsOf(i).size());
+    }
+
+    const ParticleStore* finer = &particles;
+    uint32_t finerRows = rows;
+    uint32_t finerCols = cols;
+    std::vector<uint32_t> rowLines;
+    std::vector<uint32_t> columnLines;
+
+    while (static_cast<int>(levels.size()) < maxLevels &&
+        std::min(finerRows, finerCols) / 2 + 1 >= MULTIGRID_MIN_SIDE) {
+        coarseLines(finerRows, rowLines);
+        coarseLines(finerCols, columnLines);
+
+        auto level = std::make_unique<Level>();
+        level->rows = static_cast<uint32_t>(rowLines.size());
+        level->cols = static_cast<uint32_t>(columnLines.size());
+        level->finerCols = finerCols;
+
+        // Interpolation weights along each axis, from the finer lines'
+        // rest positions so the uneven last interval is weighted right
+        auto weights = [&](const std::vector<uint32_t>& lines, uint32_t finerCount, bool alongRows,
+            std::vector<uint32_t>& below, std::vector<float>& weight) {
+            below.resize(finerCount);
+            weight.resize(finerCount);
+            size_t line = 0;
+            for (uint32_t i = 0; i < finerCount; ++i) {
+                while (line + 1 < lines.size() && lines[line + 1] <= i) ++line;
+                below[i] = static_cast<uint32_t>(line);
+                if (line + 1 == lines.size()) {
+                    weight[i] = 0.0f;
+                    continue;
+                }
+
+                auto rest = [&](uint32_t at) {
+                    return alongRows ? finer->restPositions[static_cast<size_t>(at) * finerCols] : finer->restPositions[at];
+                };
+                float span = glm::length(rest(lines[line + 1]) - rest(lines[line]));
+                weight[i] = span > 0.0f ? glm::length(rest(i) - rest(lines[line])) / span : 0.0f;
+            }
+        };
+        weights(rowLines, finerRows, true, level->rowBelow, level->rowWeight);
+        weights(columnLines, finerCols, false, level->columnBelow, level->columnWeight);
+
+        level->particles.reserve(rowLines.size() * columnLines.size());
+        for (uint32_t y : rowLines) {
+            for (uint32_t x : columnLines) {
+                uint32_t index = y * finerCols + x;
+                level->finerIndex.push_back(index);
+                level->particles.add(finer->restPositions[index]);
+            }
+        }
+        level->injected.resize(level->particles.size());
+
+        // The cloth's own stencil, one level coarser
+        const uint32_t r = level->rows;
+        const uint32_t c = level->cols;
+        SpringBuffer& coarseSprings = level->springs;
+        for (uint32_t y = 0; y < r; ++y) {
+            for (uint32_t x = 0; x < c; ++x) {
+                uint32_t idx = y * c + x;
+                if (x < c - 1) coarseSprings.add(level->particles, idx, idx + 1, SPRINGTYPE::STRUCTURAL);
+                if (y < r - 1) coarseSprings.add(level->particles, idx, idx + c, SPRINGTYPE::STRUCTURAL);
+                if (x < c - 1 && y < r - 1) coarseSprings.add(level->particles, idx, idx + c + 1, SPRINGTYPE::SHEAR);
+                if (x > 0 && y < r - 1) coarseSprings.add(level->particles, idx, idx + c - 1, SPRINGTYPE::SHEAR);
+                if (x < c - 2) coarseSprings.add(level->particles, idx, idx + 2, SPRINGTYPE::BEND);
+                if (y < r - 2) coarseSprings.add(level->particles, idx, idx + 2 * c, SPRINGTYPE::BEND);
+            }
+        }
+        coarseSprings.buildColors(level->particles.size());
+        level->intactSprings.resize(level->particles.size());
+        for (uint32_t i = 0; i < level->particles.size(); ++i) {
+            level->intactSprings[i] = static_cast<uint32_t>(coarseSprings.springsOf(i).size());
+        }
+
+        finer = &level->particles;
+        finerRows = r;
+        finerCols = c;
+        levels.push_back(std::move(level));
+    }
+}
+
+void Multigrid::tear(const SpringBuffer& fine) {
+    if (levels.empty()) return;
+
+    // A finer particle that lost a spring marks every coarse spring whose
+    // box of finer rows and columns holds it
+    std::vector<uint8_t> damaged(fineIntactSprings.size());
+    for (uint32_t i = 0; i < fineIntactSprings.size(); ++i) {
+        damaged[i] = fine.springsOf(i).size() < fineIntactSprings[i];
+    }
+
+    for (const auto& level : levels) {
+        const uint32_t finerCols = level->finerCols;
+        level->springs.tearWhere([&](const Spring& s) {
+            uint32_t a = level->finerIndex[s.p1];
+            uint32_t b = level->finerIndex[s.p2];
+            uint32_t x0 = std::min(a % finerCols, b % finerCols);
+            uint32_t x1 = std::max(a % finerCols, b % finerCols);
+            uint32_t y0 = std::min(a / finerCols, b / finerCols);
+            uint32_t y1 = std::max(a / finerCols, b / finerCols);
+            for (uint32_t y = y0; y <= y1; ++y) {
+                for (uint32_t x = x0; x <= x1; ++x) {
+                    if (damaged[y * finerCols + x]) return true;
+                }
+            }
+            return false;
+        });
+
+        damaged.resize(level->particles.size());
+        for (uint32_t i = 0; i < level->particles.size(); ++i) {
+            damaged[i] = level->springs.springsOf(i).size() < level->intactSprings[i];
+        }
+    }
+}
+
+void Multigrid::activateAll() {
+    for (const auto& level : levels) {
+        level->springs.activateAll();
+    }
+}
+
+TaskGraph::TaskId Multigrid::addCycleTasks(TaskGraph& graph, ParticleStore& fine, const SweepFunction& fineSweep, TaskGraph::TaskId after) {
+    TaskGraph::TaskId last = fineSweep(graph, after);
+    if (!levels.empty()) {
+        last = addLevelTasks(graph, 0, fine, last);
+        last = fineSweep(graph, last);
+    }
+    return last;
+}
+
+TaskGraph::TaskId Multigrid::addLevelTasks(TaskGraph& graph, size_t index, ParticleStore& finer, TaskGraph::TaskId after) {
+    Level& level = *levels[index];
+
+    TaskGraph::TaskId injected = graph.addParallelFor(level.particles.size(), MULTIGRID_GRAIN, [this, &level, &finer](size_t begin, size_t end) {
+        restrictLevel(level, finer, begin, end);
+    });
+    graph.precede(after, injected);
+
+    const bool coarsest = index + 1 == levels.size();
+    TaskGraph::TaskId last = injected;
+    for (int i = 0; i < (coarsest ? coarsestSweeps : smoothingSweeps); ++i) {
+        last = level.springs.addConstraintTasks(graph, level.particles, last);
+    }
+    if (!coarsest) {
+        last = addLevelTasks(graph, index + 1, level.particles, last);
+        for (int i = 0; i < smoothingSweeps; ++i) {
+            last = level.springs.addConstraintTasks(graph, level.particles, last);
+        }
+    }
+
+    TaskGraph::TaskId prolonged = graph.addParallelFor(finer.size(), MULTIGRID_GRAIN, [this, &level, &finer](size_t begin, size_t end) {
+        prolongLevel(level, finer, begin, end);
+    });
+    graph.precede(last, prolonged);
+    return prolonged;
+}
+
+void Multigrid::restrictLevel(Level& level, const ParticleStore& finer, size_t begin, size_t end) {
+    // Pinned or sleeping finer particles stay put here too
+    for (size_t i = begin; i < end; ++i) {
+        uint32_t source = level.finerIndex[i];
+        level.particles.positions[i] = finer.positions[source];
+        level.particles.invMass[i] = finer.invMass[source];
+        level.injected[i] = finer.positions[source];
+    }
+}
+
+void Multigrid::prolongLevel(const Level& level, ParticleStore& finer, size_t begin, size_t end) const {
+    const glm::vec3* positions = level.particles.positions.data();
+    const uint32_t cols = level.cols;
+    for (size_t i = begin; i < end; ++i) {
+        if (finer.invMass[i] == 0.0f) continue;
+
+        uint32_t fy = static_cast<uint32_t>(i / level.finerCols);
+        uint32_t fx = static_cast<uint32_t>(i % level.finerCols);
+        uint32_t y0 = level.rowBelow[fy];
+        uint32_t x0 = level.columnBelow[fx];
+        uint32_t y1 = std::min(y0 + 1, level.rows - 1);
+        uint32_t x1 = std::min(x0 + 1, cols - 1);
+        float wy = level.rowWeight[fy];
+        float wx = level.columnWeight[fx];
+
+        auto moved = [&](uint32_t y, uint32_t x) {
+            uint32_t k = y * cols + x;
+            return positions[k] - level.injected[k];
+        };
+        glm::vec3 top = moved(y0, x0) * (1.0f - wx) + moved(y0, x1) * wx;
+        glm::vec3 bottom = moved(y1, x0) * (1.0f - wx) + moved(y1, x1) * wx;
+        finer.positions[i] += top * (1.0f - wy) + bottom * wy;
+    }
+}
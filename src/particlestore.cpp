@@ -0,0 +1,63 @@
+#include "particlestore.hpp"
+
+void ParticleStore::clear() {
+    positions.clear();
+    prevPositions.clear();
+    forces.clear();
+    invMass.clear();
+    restPositions.clear();
+}
+
+void ParticleStore::reserve(size_t count) {
+    positions.reserve(count);
+    prevPositions.reserve(count);
+    forces.reserve(count);
+    invMass.reserve(count);
+    restPositions.reserve(count);
+}
+
+uint32_t ParticleStore::add(const glm::vec3& startPos, float m) {
+    positions.push_back(startPos);
+    prevPositions.push_back(startPos);
+    forces.push_back(glm::vec3(0.0f));
+    invMass.push_back(1.0f / m);
+    restPositions.push_back(startPos);
+    return static_cast<uint32_t>(positions.size() - 1);
+}
+
+void ParticleStore::pin(size_t i) {
+    invMass[i] = 0.0f;
+}
+
+void ParticleStore::unpin(size_t i, float m) {
+    invMass[i] = 1.0f / m;
+}
+
+void ParticleStore::pinTo(size_t i, const glm::vec3& pos) {
+    invMass[i] = 0.0f;
+    positions[i] = pos;
+    prevPositions[i] = pos;
+}
+
+void ParticleStore::updateVerlet(float dt, const glm::vec3& gravity) {
+    updateVerlet(dt, gravity, 0, positions.size());
+}
+
+void ParticleStore::updateVerlet(float dt, const glm::vec3& gravity, size_t begin, size_t end) {
+    const float dt2 = dt * dt;
+
+    glm::vec3* pos = positions.data();
+    glm::vec3* prev = prevPositions.data();
+    glm::vec3* force = forces.data();
+    const float* w = invMass.data();
+
+    for (size_t i = begin; i < end; ++i) {
+        if (w[i] != 0.0f) {
+            glm::vec3 temp = pos[i];
+            glm::vec3 acceleration = force[i] * w[i] + gravity;
+            pos[i] += (pos[i] - prev[i]) + acceleration * dt2;
+            prev[i] = temp;
+        }
+        force[i] = glm::vec3(0.0f);
+    }
+}
@@ -0,0 +1,259 @@
+#include "projectivesolver.hpp"
+#include <algorithm>
+#include <numeric>
+
+// Regions this small are ordered row by row
+constexpr uint32_t DISSECTION_LEAF = 64;
+
+ProjectiveSolver::ProjectiveSolver()
+    : rows(0)
+    , cols(0)
+    , current(false)
+    , factoredDt(0.0f)
+    , factoredWeights{}
+    , factorizations(0)
+    , weights{}
+    , inertia(0.0f)
+{
+}
+
+void ProjectiveSolver::init(uint32_t particleRows, uint32_t particleCols) {
+    rows = particleRows;
+    cols = particleCols;
+    order.clear();
+    asleep.clear();
+    sleepingInvMass.clear();
+    current = false;
+}
+
+void ProjectiveSolver::setSleeping(std::span<const uint8_t> particleAsleep, std::span<const float> savedInvMass) {
+    asleep.assign(particleAsleep.begin(), particleAsleep.end());
+    sleepingInvMass.assign(savedInvMass.begin(), savedInvMass.end());
+}
+
+TaskGraph::TaskId ProjectiveSolver::addStartTasks(TaskGraph& graph, ParticleStore& particles, const SpringBuffer& springs, float dt, TaskGraph::TaskId after) {
+    const size_t count = particles.size();
+    if (order.size() != count) {
+        buildOrder(count);
+        current = false;
+    }
+    inertial.resize(count);
+    projections.resize(springs.size());
+    for (size_t axis = 0; axis < 3; ++axis) {
+        rhs[axis].resize(count);
+        work[axis].resize(count);
+    }
+
+    // Refactoring is serial, but it only happens after tears, pinning or new
+    // weights
+    TaskGraph::TaskId prepare = graph.add([this, &particles, &springs, dt] {
+        for (size_t type = 0; type < weights.size(); ++type) {
+            weights[type] = 1.0f / std::max(springs.compliance[type], 1e-12f);
+        }
+        inertia = 1.0f / (dt * dt);
+        if (needsFactor(particles, dt)) {
+            factor(particles, springs, dt);
+        }
+    });
+    graph.precede(after, prepare);
+
+    TaskGraph::TaskId keep = graph.addParallelFor(count, PROJECTIVE_GRAIN, [this, &particles](size_t begin, size_t end) {
+        std::copy(particles.positions.begin() + begin, particles.positions.begin() + end, inertial.begin() + begin);
+    });
+    graph.precede(prepare, keep);
+    return keep;
+}
+
+TaskGraph::TaskId ProjectiveSolver::addIterationTasks(TaskGraph& graph, ParticleStore& particles, const SpringBuffer& springs, TaskGraph::TaskId after) {
+    // Local step: every spring picks its own target independently
+    TaskGraph::TaskId local = graph.addParallelFor(springs.size(), SPRING_PARALLEL_GRAIN, [this, &particles, &springs](size_t begin, size_t end) {
+        project(particles, springs, begin, end);
+    });
+    graph.precede(after, local);
+
+    TaskGraph::TaskId assembled = graph.addParallelFor(particles.size(), PROJECTIVE_GRAIN, [this, &particles, &springs](size_t begin, size_t end) {
+        assemble(particles, springs, begin, end);
+    });
+    graph.precede(local, assembled);
+
+    // Global step: the axes are independent solves against the same factor
+    TaskGraph::TaskId solved = graph.addParallelFor(particles.size(), PROJECTIVE_GRAIN, [this, &particles](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            if (particles.invMass[i] == 0.0f) continue;
+            particles.positions[i] = glm::vec3(rhs[0][i], rhs[1][i], rhs[2][i]);
+        }
+    });
+    for (size_t axis = 0; axis < 3; ++axis) {
+        TaskGraph::TaskId solve = graph.add([this, axis] {
+            if (cholesky.empty()) return;
+            cholesky.solve(rhs[axis], work[axis]);
+        });
+        graph.precede(assembled, solve);
+        graph.precede(solve, solved);
+    }
+    return solved;
+}
+
+bool ProjectiveSolver::needsFactor(const ParticleStore& particles, float dt) const {
+    if (!current || dt != factoredDt || weights != factoredWeights) return true;
+
+    for (size_t i = 0; i < particles.size(); ++i) {
+        if ((inverseMass(particles, i) == 0.0f) != (pinned[i] != 0)) return true;
+    }
+    return false;
+}
+
+void ProjectiveSolver::factor(const ParticleStore& particles, const SpringBuffer& springs, float dt) {
+    const size_t count = particles.size();
+    pinned.resize(count);
+    for (size_t i = 0; i < count; ++i) {
+        pinned[i] = inverseMass(particles, i) == 0.0f;
+    }
+
+    // Rows of M / h^2 + L, with springs to pinned particles folded into the
+    // diagonal only
+    std::vector<uint32_t> rowOffsets(count + 1, 0);
+    std::vector<uint32_t> columns;
+    std::vector<double> values;
+    columns.reserve(count * 13);
+    values.reserve(count * 13);
+
+    std::vector<std::pair<uint32_t, double>> entries;
+    for (size_t i = 0; i < count; ++i) {
+        entries.clear();
+        if (pinned[i]) {
+            entries.push_back({ static_cast<uint32_t>(i), 1.0 });
+        }
+        else {
+            double diagonal = static_cast<double>(inertia) / inverseMass(particles, i);
+            for (uint32_t index : springs.springsOf(static_cast<uint32_t>(i))) {
+                const Spring& s = springs[index];
+                const double w = weights[static_cast<size_t>(s.type)];
+                uint32_t other = s.p1 == i ? s.p2 : s.p1;
+
+                diagonal += w;
+                if (!pinned[other]) {
+                    entries.push_back({ other, -w });
+                }
+            }
+            entries.push_back({ static_cast<uint32_t>(i), diagonal });
+
+            // Parallel springs between the same two particles share an entry
+            std::sort(entries.begin(), entries.end());
+            size_t merged = 0;
+            for (size_t e = 1; e < entries.size(); ++e) {
+                if (entries[e].first == entries[merged].first) {
+                    entries[merged].second += entries[e].second;
+                }
+                else {
+                    entries[++merged] = entries[e];
+                }
+            }
+            entries.resize(merged + 1);
+        }
+
+        for (const auto& [column, value] : entries) {
+            columns.push_back(column);
+            values.push_back(value);
+        }
+        rowOffsets[i + 1] = static_cast<uint32_t>(columns.size());
+    }
+
+    cholesky.factor(rowOffsets, columns, values, order);
+    factoredDt = dt;
+    factoredWeights = weights;
+    current = true;
+    ++factorizations;
+}
+
+void ProjectiveSolver::buildOrder(size_t count) {
+    order.clear();
+    order.reserve(count);
+    if (static_cast<size_t>(rows) * cols == count) {
+        dissect(0, cols, 0, rows);
+    }
+    else {
+        order.resize(count);
+        std::iota(order.begin(), order.end(), 0u);
+    }
+}
+
+void ProjectiveSolver::dissect(uint32_t x0, uint32_t x1, uint32_t y0, uint32_t y1) {
+    // Nested dissection: split the longer side with a separator two lines
+    // wide, since bend springs reach over one line, and order the separator
+    // after both halves so eliminating one half never fills the other
+    const uint32_t width = x1 - x0;
+    const uint32_t height = y1 - y0;
+    if (width * height <= DISSECTION_LEAF || std::max(width, height) < 5) {
+        for (uint32_t y = y0; y < y1; ++y) {
+            for (uint32_t x = x0; x < x1; ++x) {
+                order.push_back(y * cols + x);
+            }
+        }
+        return;
+    }
+
+    if (width >= height) {
+        uint32_t middle = x0 + width / 2 - 1;
+        dissect(x0, middle, y0, y1);
+        dissect(middle + 2, x1, y0, y1);
+        dissect(middle, middle + 2, y0, y1);
+    }
+    else {
+        uint32_t middle = y0 + height / 2 - 1;
+        dissect(x0, x1, y0, middle);
+        dissect(x0, x1, middle + 2, y1);
+        dissect(x0, x1, middle, middle + 2);
+    }
+}
+
+void ProjectiveSolver::project(const ParticleStore& particles, const SpringBuffer& springs, size_t begin, size_t end) {
+    const glm::vec3* positions = particles.positions.data();
+    for (size_t i = begin; i < end; ++i) {
+        const Spring& s = springs[i];
+        if (!s.active) continue;
+
+        glm::vec3 delta = positions[s.p2] - positions[s.p1];
+        float currentLength = glm::length(delta);
+        projections[i] = currentLength > 0.0f ? delta * (s.restLength / currentLength) : glm::vec3(0.0f);
+    }
+}
+
+void ProjectiveSolver::assemble(const ParticleStore& particles, const SpringBuffer& springs, size_t begin, size_t end) {
+    // The terms are large (weights reach 1e6) and mostly cancel, so they're
+    // added up in doubles like the factor
+    const glm::vec3* positions = particles.positions.data();
+    for (size_t i = begin; i < end; ++i) {
+        double b[3];
+        if (pinned[i]) {
+            for (int axis = 0; axis < 3; ++axis) {
+                b[axis] = positions[i][axis];
+            }
+        }
+        else {
+            // Sleeping particles aren't integrated, so their target is where
+            // they froze; the solve never moves them
+            const double mass = static_cast<double>(inertia) / inverseMass(particles, i);
+            for (int axis = 0; axis < 3; ++axis) {
+                b[axis] = mass * inertial[i][axis];
+            }
+            for (uint32_t index : springs.springsOf(static_cast<uint32_t>(i))) {
+                const Spring& s = springs[index];
+                const double w = weights[static_cast<size_t>(s.type)];
+                const double sign = s.p1 == i ? -1.0 : 1.0;
+                uint32_t other = s.p1 == i ? s.p2 : s.p1;
+
+                for (int axis = 0; axis < 3; ++axis) {
+                    b[axis] += sign * w * projections[index][axis];
+                    if (pinned[other]) {
+                        b[axis] += w * positions[other][axis];
+                    }
+                }
+            }
+        }
+
+        for (int axis = 0; axis < 3; ++axis) {
+            rhs[axis][i] = b[axis];
+        }
+    }
+}
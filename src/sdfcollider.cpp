@@ -0,0 +1,193 @@
+#include "sdfcollider.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <utility>
+
+namespace
+{
+    constexpr char SDF_MAGIC[4] = { 'S', 'D', 'F', '1' };
+
+    struct SdfFileHeader {
+        char magic[4];
+        int32_t dims[3];
+        float origin[3];
+        float cellSize;
+        uint64_t sourceKey;
+    };
+}
+
+SdfCollider::SdfCollider()
+    : origin(0.0f)
+    , dims(0)
+    , cellSize(1.0f)
+    , invCellSize(1.0f)
+    , sourceKey(0)
+{
+}
+
+uint64_t SdfCollider::makeKey(const MeshCollider& mesh, float cellSize, float padding) {
+    uint64_t key = mesh.contentHash();
+    for (float setting : { cellSize, padding }) {
+        uint32_t bits;
+        std::memcpy(&bits, &setting, sizeof(bits));
+        key = (key ^ bits) * 1099511628211ull;
+    }
+    return key;
+}
+
+void SdfCollider::bake(const MeshCollider& mesh, float bakeCellSize, float padding, JobSystem& jobs) {
+    cellSize = bakeCellSize;
+    invCellSize = 1.0f / cellSize;
+    sourceKey = makeKey(mesh, bakeCellSize, padding);
+
+    glm::vec3 extent = mesh.getBoundsMax() - mesh.getBoundsMin() + glm::vec3(2.0f * padding);
+    origin = mesh.getBoundsMin() - glm::vec3(padding);
+    dims = glm::ivec3(
+        static_cast<int>(std::ceil(extent.x * invCellSize)) + 1,
+        static_cast<int>(std::ceil(extent.y * invCellSize)) + 1,
+        static_cast<int>(std::ceil(extent.z * invCellSize)) + 1);
+
+    size_t count = static_cast<size_t>(dims.x) * dims.y * dims.z;
+    distances.resize(count);
+    gradients.resize(count);
+
+    // Nothing in the grid is farther from the mesh than its diagonal
+    const float reach = glm::length(glm::vec3(dims) * cellSize);
+
+    jobs.parallelFor(count, SDF_BAKE_GRAIN, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            int x = static_cast<int>(i % dims.x);
+            int y = static_cast<int>((i / dims.x) % dims.y);
+            int z = static_cast<int>(i / (static_cast<size_t>(dims.x) * dims.y));
+            glm::vec3 p = origin + glm::vec3(x, y, z) * cellSize;
+
+            glm::vec3 closest, normal;
+            if (!mesh.closestPoint(p, reach, closest, normal)) {
+                distances[i] = reach;
+                continue;
+            }
+
+            // The side comes from the closest triangle's face normal
+            float distance = glm::length(p - closest);
+            distances[i] = glm::dot(p - closest, normal) < 0.0f ? -distance : distance;
+        }
+    });
+
+    jobs.parallelFor(count, SDF_BAKE_GRAIN, [this](size_t begin, size_t end) {
+        computeGradients(begin, end);
+    });
+}
+
+void SdfCollider::computeGradients(size_t begin, size_t end) {
+    // Central differences, one-sided on the faces of the grid
+    for (size_t i = begin; i < end; ++i) {
+        int x = static_cast<int>(i % dims.x);
+        int y = static_cast<int>((i / dims.x) % dims.y);
+        int z = static_cast<int>(i / (static_cast<size_t>(dims.x) * dims.y));
+
+        auto difference = [&](int axis) {
+            glm::ivec3 lo(x, y, z);
+            glm::ivec3 hi(x, y, z);
+            lo[axis] = std::max(lo[axis] - 1, 0);
+            hi[axis] = std::min(hi[axis] + 1, dims[axis] - 1);
+            if (hi[axis] == lo[axis]) return 0.0f;
+
+            return (distances[indexOf(hi.x, hi.y, hi.z)] - distances[indexOf(lo.x, lo.y, lo.z)])
+                / (static_cast<float>(hi[axis] - lo[axis]) * cellSize);
+        };
+
+        gradients[i] = glm::vec3(difference(0), difference(1), difference(2));
+    }
+}
+
+bool SdfCollider::sample(const glm::vec3& p, float& distance, glm::vec3& gradient) const {
+    if (distances.empty()) return false;
+
+    glm::vec3 g = (p - origin) * invCellSize;
+    if (g.x < 0.0f || g.y < 0.0f || g.z < 0.0f ||
+        g.x > dims.x - 1 || g.y > dims.y - 1 || g.z > dims.z - 1) {
+        return false;
+    }
+
+    // Clamp so the far face still has a cell to interpolate in
+    int x = std::min(static_cast<int>(g.x), dims.x - 2);
+    int y = std::min(static_cast<int>(g.y), dims.y - 2);
+    int z = std::min(static_cast<int>(g.z), dims.z - 2);
+    glm::vec3 f = g - glm::vec3(x, y, z);
+
+    distance = 0.0f;
+    gradient = glm::vec3(0.0f);
+    for (int corner = 0; corner < 8; ++corner) {
+        int dx = corner & 1;
+        int dy = (corner >> 1) & 1;
+        int dz = (corner >> 2) & 1;
+        float weight = (dx ? f.x : 1.0f - f.x) * (dy ? f.y : 1.0f - f.y) * (dz ? f.z : 1.0f - f.z);
+
+        size_t i = indexOf(x + dx, y + dy, z + dz);
+        distance += distances[i] * weight;
+        gradient += gradients[i] * weight;
+    }
+    return true;
+}
+
+bool SdfCollider::save(const std::filesystem::path& path) const {
+    std::ofstream file(path, std::ios::binary);
+    if (!file) return false;
+
+    SdfFileHeader header{};
+    std::memcpy(header.magic, SDF_MAGIC, sizeof(header.magic));
+    header.dims[0] = dims.x;
+    header.dims[1] = dims.y;
+    header.dims[2] = dims.z;
+    header.origin[0] = origin.x;
+    header.origin[1] = origin.y;
+    header.origin[2] = origin.z;
+    header.cellSize = cellSize;
+    header.sourceKey = sourceKey;
+
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(distances.data()), distances.size() * sizeof(float));
+    file.write(reinterpret_cast<const char*>(gradients.data()), gradients.size() * sizeof(glm::vec3));
+    return static_cast<bool>(file);
+}
+
+bool SdfCollider::load(const std::filesystem::path& path, uint64_t expectedKey) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) return false;
+
+    SdfFileHeader header{};
+    file.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (!file || std::memcmp(header.magic, SDF_MAGIC, sizeof(header.magic)) != 0 || header.sourceKey != expectedKey) {
+        return false;
+    }
+    if (header.dims[0] < 2 || header.dims[1] < 2 || header.dims[2] < 2 || header.cellSize <= 0.0f) {
+        return false;
+    }
+
+    size_t count = static_cast<size_t>(header.dims[0]) * header.dims[1] * header.dims[2];
+    std::vector<float> loadedDistances(count);
+    AlignedVector<glm::vec3> loadedGradients(count);
+    file.read(reinterpret_cast<char*>(loadedDistances.data()), count * sizeof(float));
+    file.read(reinterpret_cast<char*>(loadedGradients.data()), count * sizeof(glm::vec3));
+    if (!file) return false;
+
+    dims = glm::ivec3(header.dims[0], header.dims[1], header.dims[2]);
+    origin = glm::vec3(header.origin[0], header.origin[1], header.origin[2]);
+    cellSize = header.cellSize;
+    invCellSize = 1.0f / cellSize;
+    sourceKey = header.sourceKey;
+    distances = std::move(loadedDistances);
+    gradients = std::move(loadedGradients);
+    return true;
+}
+
+bool SdfCollider::bakeCached(const MeshCollider& mesh, float bakeCellSize, float padding, const std::filesystem::path& path, JobSystem& jobs) {
+    if (load(path, makeKey(mesh, bakeCellSize, padding))) {
+        return true;
+    }
+
+    bake(mesh, bakeCellSize, padding, jobs);
+    return save(path);
+}
@@ -0,0 +1,162 @@
+#include "selfcollision.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    // Neighbour lists reach this much past the thickness, so particles that
+    // close in during the step's iterations are already on them
+    constexpr float LIST_MARGIN = 0.5f;
+}
+
+SelfCollision::SelfCollision()
+    : thickness(0.07f)
+    , restingGridCurrent(false)
+    , listThickness(0.07f)
+{
+}
+
+void SelfCollision::setSleeping(std::span<const uint8_t> particleAsleep) {
+    awake.clear();
+    resting.clear();
+    restingGridCurrent = false;
+    for (size_t i = 0; i < particleAsleep.size(); ++i) {
+        (particleAsleep[i] ? resting : awake).push_back(static_cast<uint32_t>(i));
+    }
+}
+
+void SelfCollision::prepare(const ParticleStore& particles) {
+    const float reach = thickness * (1.0f + LIST_MARGIN);
+    if (thickness != listThickness) {
+        restingGridCurrent = false;
+    }
+    listThickness = thickness;
+
+    if (resting.empty()) {
+        grid.build(particles.positions.data(), particles.size(), reach);
+        restingGrid.clear();
+    }
+    else {
+        // Sleeping particles don't move, so their hash lasts until one wakes
+        grid.build(particles.positions.data(), awake, reach);
+        if (!restingGridCurrent) {
+            restingGrid.build(particles.positions.data(), resting, reach);
+            restingGridCurrent = true;
+        }
+    }
+
+    // Only awake particles' lists are read, and every step rewrites them
+    neighbors.resize(particles.size() * MAX_SELF_COLLISION_NEIGHBORS);
+    neighborCounts.resize(particles.size());
+    corrections.resize(particles.size());
+}
+
+void SelfCollision::findNeighbors(const ParticleStore& particles, size_t begin, size_t end) {
+    const glm::vec3* positions = particles.positions.data();
+    const glm::vec3* rest = particles.restPositions.data();
+    const float reach = listThickness * (1.0f + LIST_MARGIN);
+    const float reachSq = reach * reach;
+
+    // Walking the hash order keeps each chunk to a few neighbouring cells
+    std::span<const uint32_t> order = grid.sortedParticles();
+
+    for (size_t k = begin; k < end; ++k) {
+        uint32_t i = order[k];
+        uint32_t* list = &neighbors[i * MAX_SELF_COLLISION_NEIGHBORS];
+        uint32_t count = 0;
+
+        auto gather = [&](uint32_t j) {
+            if (j == i || count == MAX_SELF_COLLISION_NEIGHBORS) return;
+
+            glm::vec3 offset = positions[i] - positions[j];
+            if (glm::dot(offset, offset) >= reachSq) return;
+
+            // Pairs this close at rest are neighbours in the cloth and the
+            // springs' business
+            glm::vec3 restOffset = rest[i] - rest[j];
+            if (glm::dot(restOffset, restOffset) < reachSq) return;
+
+            // Cells that share a slot can report the same particle twice
+            if (std::find(list, list + count, j) != list + count) return;
+
+            list[count++] = j;
+        };
+        grid.forEachCandidate(positions[i], reach, gather);
+        restingGrid.forEachCandidate(positions[i], reach, gather);
+
+        neighborCounts[i] = static_cast<uint8_t>(count);
+    }
+}
+
+void SelfCollision::computeCorrections(const ParticleStore& particles, size_t begin, size_t end) {
+    const glm::vec3* positions = particles.positions.data();
+    const float* invMass = particles.invMass.data();
+    const float thicknessSq = listThickness * listThickness;
+
+    for (size_t k = begin; k < end; ++k) {
+        const uint32_t i = activeParticle(k);
+        corrections[i] = glm::vec3(0.0f);
+        if (invMass[i] == 0.0f) continue;
+
+        const uint32_t* list = &neighbors[i * MAX_SELF_COLLISION_NEIGHBORS];
+        glm::vec3 sum(0.0f);
+        int contacts = 0;
+
+        for (uint32_t n = 0; n < neighborCounts[i]; ++n) {
+            uint32_t j = list[n];
+
+            glm::vec3 offset = positions[i] - positions[j];
+            float distSq = glm::dot(offset, offset);
+            if (distSq >= thicknessSq || distSq == 0.0f) continue;
+
+            float dist = std::sqrt(distSq);
+
+            // Each side takes half, unless the other one is pinned
+            float share = invMass[j] == 0.0f ? 1.0f : 0.5f;
+            sum += offset * ((listThickness - dist) / dist * share);
+            ++contacts;
+        }
+
+        if (contacts > 0) {
+            corrections[i] = sum / static_cast<float>(contacts);
+        }
+    }
+}
+
+void SelfCollision::applyCorrections(ParticleStore& particles, size_t begin, size_t end) const {
+    glm::vec3* positions = particles.positions.data();
+
+    for (size_t k = begin; k < end; ++k) {
+        const uint32_t i = activeParticle(k);
+        positions[i] += corrections[i];
+    }
+}
+
+TaskGraph::TaskId SelfCollision::addBroadphaseTasks(TaskGraph& graph, const ParticleStore& particles, TaskGraph::TaskId after) {
+    TaskGraph::TaskId hash = graph.add([this, &particles] {
+        prepare(particles);
+    });
+    graph.precede(after, hash);
+
+    TaskGraph::TaskId lists = graph.addParallelFor(activeCount(particles), SELF_COLLISION_GRAIN,
+        [this, &particles](size_t begin, size_t end) {
+            findNeighbors(particles, begin, end);
+        });
+    graph.precede(hash, lists);
+    return lists;
+}
+
+TaskGraph::TaskId SelfCollision::addSolveTasks(TaskGraph& graph, ParticleStore& particles, TaskGraph::TaskId after) {
+    TaskGraph::TaskId compute = graph.addParallelFor(activeCount(particles), SELF_COLLISION_GRAIN,
+        [this, &particles](size_t begin, size_t end) {
+            computeCorrections(particles, begin, end);
+        });
+    graph.precede(after, compute);
+
+    TaskGraph::TaskId apply = graph.addParallelFor(activeCount(particles), SELF_COLLISION_GRAIN,
+        [this, &particles](size_t begin, size_t end) {
+            applyCorrections(particles, begin, end);
+        });
+    graph.precede(compute, apply);
+    return apply;
+}
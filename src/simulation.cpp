@@ -2,8 +2,15 @@
 
 bool Simulation::vsync = true;
 
-Simulation::Simulation()
-    : fullscreen(true)
+Simulation::Simulation(const SimulationConfig& config)
+    : rows(std::clamp(config.rows, MIN_CLOTH_SIDE, MAX_CLOTH_SIDE))
+    , cols(std::clamp(config.cols, MIN_CLOTH_SIDE, MAX_CLOTH_SIDE))
+    , spacing(std::clamp(config.spacing, MIN_CLOTH_SPACING, MAX_CLOTH_SPACING))
+    , continuousCollision(true)
+    , multigridEnabled(config.multigrid)
+    , particleGridCurrent(false)
+    , selfCollisionModes{ false, true, false }
+    , fullscreen(true)
     , isIconSet(false)
     , running(false)
     , w(0)
@@ -44,141 +51,182 @@ Simulation::Simulation()
     , currentMode(SIMMODE::TEAR)
     , currentPinning(PINNINGMODE::TOP_ROW)
     , currentCollisionShape(COLLISIONSHAPE::SPHERE)
+    , currentSolver(config.solver)
     , projectionMatrix(glm::mat4(0.0f))
     , isCameraActive(false)
     , camera(glm::vec3((cols - 1) * spacing * 0.5f, -(rows - 1) * spacing * 0.5f, 10.0f))
+    , jobs(config.workerCount, config.pinThreads)
+    , currentStepMode(config.substeps > 0 ? STEPMODE::SUBSTEPS : config.implicitScale > 0 ? STEPMODE::IMPLICIT : STEPMODE::ITERATIONS)
+    , substeps(config.substeps > 0 ? config.substeps : CONSTRAINT_ITERATIONS)
+    , implicitScale(config.implicitScale > 0 ? std::min(config.implicitScale, MAX_IMPLICIT_SCALE) : MAX_IMPLICIT_SCALE / 2)
+    , adaptiveIterations(config.residualTolerance > 0.0f)
+    , residualTolerance(config.residualTolerance)
+    , minIterations(std::max(config.minIterations, 1))
+    , maxIterations(std::max(config.maxIterations, 1))
+    , sleepEnabled(config.sleeping)
+    , lastIterations(0.0f)
+    , lastResidual{ 0.0f, 0.0f }
+    , pendingSteps(0)
+    , stepGravity(0.0f)
+    , simulationTime(0.0f)
+    , drawnNormals(0)
 {
  
     collisionObject.position = glm::vec3((cols - 1) * spacing * 0.5f, -5.0f, -2.0f);
     collisionObject.size = glm::vec3(3.0f, 3.0f, 3.0f); // Sphere radius or cube size
 
-    if (currentMode == SIMMODE::COLLISION) {
-        for (int y = 0; y < rows; ++y) {
-            for (int x = 0; x < cols; ++x) {
-                glm::vec3 pos = glm::vec3(x * spacing, 0.0f, -y * spacing); // Horizontal layout
-                particles.emplace_back(pos, 1.0f);
-            }
-        }
-    }
-    else {
-        for (int y = 0; y < rows; ++y) {
-            for (int x = 0; x < cols; ++x) {
-                glm::vec3 pos = glm::vec3(x * spacing, -y * spacing, 0.0f); // Vertical layout
-                particles.emplace_back(pos, 1.0f);
-            }
+    // Spring constants are shared per spring type
+    applySpringMaterials();
+    springs.jacobiRelaxation = config.jacobiRelaxation;
+    accelerator.mode = config.acceleration;
+    wind.seed = config.windSeed;
+    springs.setCompliance(SPRINGTYPE::STRUCTURAL, structural_compliance);
+    springs.setCompliance(SPRINGTYPE::SHEAR, shear_compliance);
+    springs.setCompliance(SPRINGTYPE::BEND, bend_compliance);
+
+    buildCloth();
+    applyPinning();
+    rebuildColliders();
+    buildStepGraph();
+}
+
+void Simulation::buildCloth() {
+    // Every array is sized from rows x cols up front and filled in place, so
+    // a million particle cloth costs one allocation per array
+    const size_t count = static_cast<size_t>(rows) * cols;
+
+    particles.clear();
+    particles.reserve(count);
+    for (int y = 0; y < rows; ++y) {
+        for (int x = 0; x < cols; ++x) {
+            glm::vec3 pos = currentMode == SIMMODE::COLLISION
+                ? glm::vec3(x * spacing, 0.0f, -y * spacing)  // Horizontal layout
+                : glm::vec3(x * spacing, -y * spacing, 0.0f); // Vertical layout
+            particles.add(pos, 1.0f);
         }
     }
 
-    
+    // Cloth is as thick as the gap between its particles
+    selfCollision.thickness = spacing;
 
     // Create springs
+    const size_t structural = static_cast<size_t>(rows) * (cols - 1) + static_cast<size_t>(rows - 1) * cols;
+    const size_t shear = static_cast<size_t>(rows - 1) * (cols - 1) * 2;
+    const size_t bend = static_cast<size_t>(rows) * std::max(cols - 2, 0) + static_cast<size_t>(std::max(rows - 2, 0)) * cols;
+    springs.clear();
+    springs.reserve(structural + shear + bend);
     for (int y = 0; y < rows; ++y) {
         for (int x = 0; x < cols; ++x) {
             int idx = y * cols + x;
 
             // Structural springs (horizontal and vertical)
             if (x < cols - 1) { // spring to right neighbor
-                springs.emplace_back(&particles[idx], &particles[idx + 1], k_structural, structural_damping);
+                springs.add(particles, idx, idx + 1, SPRINGTYPE::STRUCTURAL);
             }
             if (y < rows - 1) { // spring to neighbor below
-                springs.emplace_back(&particles[idx], &particles[idx + cols], k_structural, structural_damping);
+                springs.add(particles, idx, idx + cols, SPRINGTYPE::STRUCTURAL);
             }
 
             // Shear springs (diagonal)
             if (x < cols - 1 && y < rows - 1) { // diagonal down-right
-                springs.emplace_back(&particles[idx], &particles[idx + cols + 1], k_shear, shear_damping);
+                springs.add(particles, idx, idx + cols + 1, SPRINGTYPE::SHEAR);
             }
             if (x > 0 && y < rows - 1) { // diagonal down-left
-                springs.emplace_back(&particles[idx], &particles[idx + cols - 1], k_shear, shear_damping);
+                springs.add(particles, idx, idx + cols - 1, SPRINGTYPE::SHEAR);
             }
 
             // Bend springs (connect particles 2 steps apart)
             if (x < cols - 2) { // bend spring 2 steps to the right
-                springs.emplace_back(&particles[idx], &particles[idx + 2], k_bend, bend_damping);
+                springs.add(particles, idx, idx + 2, SPRINGTYPE::BEND);
             }
             if (y < rows - 2) { // bend spring 2 steps down
-                springs.emplace_back(&particles[idx], &particles[idx + 2 * cols], k_bend, bend_damping);
+                springs.add(particles, idx, idx + 2 * cols, SPRINGTYPE::BEND);
             }
         }
     }
+    springs.buildColors(particles.size());
+    sleepTiles.init(rows, cols);
+    projective.init(rows, cols);
+    multigrid.build(particles, springs, rows, cols, MULTIGRID_LEVELS);
 
-    // Generate cloth texture coordinates
+    // Cloth and flag texture coordinates
+    clothTexCoords.resize(count);
     for (int y = 0; y < rows; ++y) {
         for (int x = 0; x < cols; ++x) {
-            clothTexCoords.emplace_back(
+            clothTexCoords[static_cast<size_t>(y) * cols + x] = glm::vec2(
                 (float)x / (cols - 1),
                 (float)y / (rows - 1)
             );
         }
     }
+    flagTexCoords = clothTexCoords;
 
-    // Generate flag texture coordinates
-    for (int y = 0; y < rows; ++y) {
-        for (int x = 0; x < cols; ++x) {
-            flagTexCoords.emplace_back(
-                (float)x / (cols - 1),
-                (float)y / (rows - 1)
-            );
-        }
-    }
-
-    // Generate indices for cloth and flag mesh
+    // Indices for cloth and flag mesh, two triangles per quad
+    clothIndices.resize(static_cast<size_t>(rows - 1) * (cols - 1) * 6);
+    size_t k = 0;
     for (int y = 0; y < rows - 1; ++y) {
         for (int x = 0; x < cols - 1; ++x) {
-            int topLeft = y * cols + x;
-            int topRight = y * cols + (x + 1);
-            int bottomLeft = (y + 1) * cols + x;
-            int bottomRight = (y + 1) * cols + (x + 1);
-
-            clothIndices.emplace_back(topLeft);
-            clothIndices.emplace_back(bottomLeft);
-            clothIndices.emplace_back(topRight);
-
-            clothIndices.emplace_back(topRight);
-            clothIndices.emplace_back(bottomLeft);
-            clothIndices.emplace_back(bottomRight);
-
-            flagIndices.emplace_back(topLeft);
-            flagIndices.emplace_back(bottomLeft);
-            flagIndices.emplace_back(topRight);
-
-            flagIndices.emplace_back(topRight);
-            flagIndices.emplace_back(bottomLeft);
-            flagIndices.emplace_back(bottomRight);
+            unsigned int topLeft = y * cols + x;
+            unsigned int topRight = y * cols + (x + 1);
+            unsigned int bottomLeft = (y + 1) * cols + x;
+            unsigned int bottomRight = (y + 1) * cols + (x + 1);
+
+            clothIndices[k++] = topLeft;
+            clothIndices[k++] = bottomLeft;
+            clothIndices[k++] = topRight;
+
+            clothIndices[k++] = topRight;
+            clothIndices[k++] = bottomLeft;
+            clothIndices[k++] = bottomRight;
         }
     }
+    flagIndices = clothIndices;
 
-    applyPinning();
+    renderPositions.assign(particles.positions.begin(), particles.positions.end());
+    for (std::vector<glm::vec3>& normals : renderNormals) {
+        normals.assign(count, glm::vec3(0.0f, 0.0f, 1.0f));
+    }
+    aerodynamics.build(particles, flagIndices, static_cast<size_t>(cols - 1) * 2);
+    particleGridCurrent = false;
+}
 
-    springActive.resize(springs.size(), true);
+void Simulation::resizeCloth(int newRows, int newCols, float newSpacing) {
+    rows = std::clamp(newRows, MIN_CLOTH_SIDE, MAX_CLOTH_SIDE);
+    cols = std::clamp(newCols, MIN_CLOTH_SIDE, MAX_CLOTH_SIDE);
+    spacing = std::clamp(newSpacing, MIN_CLOTH_SPACING, MAX_CLOTH_SPACING);
 
+    buildCloth();
+    allocateMeshBuffers();
+    reset();
 }
 
 void Simulation::applyPinning() {
+    // Sleeping particles have their masses set aside
+    wakeAll();
 
-    for (auto& p : particles) {
-        p.pinned = false;
+    for (size_t i = 0; i < particles.size(); ++i) {
+        particles.unpin(i);
     }
 
     switch (currentPinning) {
     case PINNINGMODE::TOP_ROW:
             for (int x = 0; x < cols; ++x) {
-                particles[x].pinned = true;
+                particles.pin(x);
             }
         
         break;
     case PINNINGMODE::ALL:
-        for (auto& p : particles)
-            p.pinned = true;
+        for (size_t i = 0; i < particles.size(); ++i)
+            particles.pin(i);
         break;
     case PINNINGMODE::CORNERS:
-        particles[0].pinned = true;
-        particles[cols - 1].pinned = true;
+        particles.pin(0);
+        particles.pin(cols - 1);
         break;
 
     case PINNINGMODE::FLAG:
         for (int y = 0; y < rows; ++y) {
-            particles[y * cols + 0].pinned = true;
+            particles.pin(y * cols + 0);
         }
         /*particles[0].pinned = true;
         particles[(rows - 1) * cols].pinned = true;*/
@@ -189,203 +237,407 @@ void Simulation::applyPinning() {
     }
 }
 
-void Simulation::run() {
-    const float FIXED_DT = 1.0f / 60.0f;
-    float accumulator = 0.0f;
-    lastFrameTime = SDL_GetPerformanceCounter();
+void Simulation::buildStepGraph() {
+    // Iterations: one fixed step of external forces -> spring forces ->
+    // integration -> [collider sweep] -> [self collision broadphase], then
+    // iterationGraph once per iteration: constraint sweep -> [collisions] ->
+    // [self collision] -> [residual].
+    // Substeps: the step is cut into `substeps` short ones, each with all of
+    // the above but a single constraint sweep, and no iteration loop.
+    // Implicit: as with iterations, but the spring forces and integration
+    // are one backward Euler solve over a longer step.
+    stepGraph.clear();
+    iterationGraph.clear();
+    const std::span<const uint8_t> particleAsleep = sleepTiles.sleepingCount() > 0 ? sleepTiles.particleStates() : std::span<const uint8_t>();
+    springs.setSleeping(particleAsleep);
+    selfCollision.setSleeping(particleAsleep);
+    projective.setSleeping(particleAsleep, particleAsleep.empty() ? std::span<const float>() : sleepTiles.savedInverseMasses());
+    const bool substepping = currentStepMode == STEPMODE::SUBSTEPS;
+    const float dt = stepDt();
+
+    // The constraints of XPBD and Projective Dynamics stand in for the
+    // spring forces here too
+    if (currentStepMode == STEPMODE::IMPLICIT) {
+        implicit.prepare(particles, constraintsAreForces() ? nullptr : &springs, dt);
+    }
 
-    while (running) {
-        Uint64 currentFrameTime = SDL_GetPerformanceCounter();
-        deltaTime = (float)(currentFrameTime - lastFrameTime) / SDL_GetPerformanceFrequency();
-        lastFrameTime = currentFrameTime;
-        deltaTime = glm::min(deltaTime, 1.0f / 60.0f);
-        accumulator += deltaTime;
+    // The wind is baked once per step, substeps included
+    TaskGraph::TaskId last = TaskGraph::NONE;
+    if (currentMode == SIMMODE::FLAG) {
+        last = wind.addUpdateTasks(stepGraph, last);
+    }
 
-        processEvent();
-        if (currentMode == SIMMODE::FLAG) {
-            if (currentPinning != PINNINGMODE::FLAG) {
-                currentPinning = PINNINGMODE::FLAG;
-                applyPinning();
-            }
+    for (int i = 0; i < (substepping ? substeps : 1); ++i) {
+        // The neighbour lists have room for a whole step's movement
+        last = addIntegrationTasks(stepGraph, dt, i == 0, last);
+        if (substepping) {
+            last = addIterationTasks(stepGraph, dt, false, last);
         }
-        handleMouseActivity();
-
-       
-        while (accumulator >= FIXED_DT) {
-            // Apply forces
-            for (auto& p : particles) {
-                // Gravity
-                if (currentMode == SIMMODE::COLLISION) {
-                    p.addForce(glm::vec3(0.0f, -3.0f * p.mass, 0.0f));
-                }
-                else {
-                    p.addForce(glm::vec3(0.0f, -9.81f * p.mass, 0.0f));
-                }
+    }
 
-                // Wind for flag mode
-                if (currentMode == SIMMODE::FLAG) {
-                    const glm::vec3 windDir = glm::normalize(glm::vec3(1.0f, 0.0f, 0.0f));
-                    // Use consistent time source
-                    float t = (float)SDL_GetPerformanceCounter() / SDL_GetPerformanceFrequency();
-                    float gust = 8.0f + 5.0f * std::sin(t * 1.5f) + 3.0f * std::sin(t * 0.5f + 1.0f);
-                    glm::vec3 lift = glm::vec3(0.0f, 0.2f, 0.0f);
-                    p.addForce(windDir * gust + lift);
-
-                    // Use fixed timestep for velocity calculation
-                    glm::vec3 v = (p.position - p.prevPosition) / FIXED_DT;
-                    p.addForce(-0.1f * v);
-                }
-            }
+    if (!substepping) {
+        if (accelerating()) {
+            accelerator.prepare(particles.size());
+        }
+        last = addIterationTasks(iterationGraph, dt, accelerating(), TaskGraph::NONE);
 
-            // Apply spring forces
-            for (size_t i = 0; i < springs.size(); ++i) {
-                if (springActive[i]) {
-                    springs[i].applyForces();
-                }
-            }
+        // Measured after the collisions, which can stretch springs again
+        if (adaptiveIterations) {
+            springs.addResidualTasks(iterationGraph, particles, currentSolver == SOLVERMODE::XPBD, dt, last);
+        }
+    }
 
-            // Update particles
-            for (auto& p : particles) {
-                p.updateVerlet(FIXED_DT);
-            }
+    // The frame task runs however many fixed steps the accumulator asked for,
+    // then rehashes the particles if the mouse is tearing
+    frameGraph.clear();
+    frameGraph.add([this, substepping] {
+        int iterations = 0;
+        for (int i = 0; i < pendingSteps; ++i) {
+            updateWind();
+            jobs.run(stepGraph);
+            iterations += substepping ? 1 : runConstraintIterations();
+        }
+        lastIterations = static_cast<float>(iterations) / static_cast<float>(pendingSteps);
+        if (currentMode == SIMMODE::TEAR && leftMouseDown) {
+            rebuildParticleGrid();
+        }
+    });
+}
 
-            // Constraint satisfaction iterations
-            for (int i = 0; i < 15; ++i) {
-                for (size_t j = 0; j < springs.size(); ++j) {
-                    if (springActive[j]) {
-                        springs[j].satisfyConstraint();
-                    }
-                }
-                if (currentMode == SIMMODE::COLLISION) {
-                    handleCollisions();
-                }
-            }
+TaskGraph::TaskId Simulation::addIntegrationTasks(TaskGraph& graph, float dt, bool broadphase, TaskGraph::TaskId after) {
+    // Only the flag has forces besides the springs and gravity; the graph is
+    // rebuilt whenever the mode changes
+    TaskGraph::TaskId last = after;
+    if (currentMode == SIMMODE::FLAG) {
+        last = aerodynamics.addForceTasks(graph, particles, wind, dt, after);
+    }
 
-            accumulator -= FIXED_DT;
+    TaskGraph::TaskId integrate;
+    if (currentStepMode == STEPMODE::IMPLICIT) {
+        // The solver runs its own passes on the workers
+        integrate = graph.add([this] {
+            implicit.step(jobs, stepGravity);
+        });
+    }
+    else {
+        // XPBD's and Projective Dynamics' constraints stand in for the
+        // spring forces
+        if (!constraintsAreForces()) {
+            last = springs.addForceTasks(graph, particles, last);
         }
 
-        render();
+        integrate = addParticleTasks(graph, [this, dt](size_t begin, size_t end) {
+            particles.updateVerlet(dt, stepGravity, begin, end);
+        });
+    }
+    graph.precede(last, integrate);
+    last = integrate;
+
+    if (currentSolver == SOLVERMODE::XPBD) {
+        last = springs.addXpbdResetTasks(graph, last);
+    }
+
+    if (continuousCollision && !colliders.empty()) {
+        TaskGraph::TaskId sweep = addParticleTasks(graph, [this](size_t begin, size_t end) {
+            colliders.sweep(particles, begin, end);
+        });
+        graph.precede(last, sweep);
+        last = sweep;
+    }
+
+    // Where the particles got to without their springs is the target
+    if (currentSolver == SOLVERMODE::PROJECTIVE) {
+        last = projective.addStartTasks(graph, particles, springs, dt, last);
     }
-    clean();
-}
 
-void Simulation::handleCollisions() {
-    for (auto& p : particles) {
-        if (p.pinned) continue;
+    if (broadphase && selfCollisionModes[static_cast<size_t>(currentMode)]) {
+        last = selfCollision.addBroadphaseTasks(graph, particles, last);
+    }
+    return last;
+}
 
-        float penetrationDepth;
-        glm::vec3 normal;
-        bool collision = false;
+TaskGraph::TaskId Simulation::addIterationTasks(TaskGraph& graph, float dt, bool accelerate, TaskGraph::TaskId after) {
+    TaskGraph::TaskId last = after;
+    if (accelerate) {
+        last = accelerator.addStartTasks(graph, particles, last);
+    }
 
-        if (currentCollisionShape == COLLISIONSHAPE::SPHERE) {
-            collision = checkSphereCollision(p.position, penetrationDepth, normal);
+    switch (currentSolver) {
+    case SOLVERMODE::JACOBI:
+        if (multigridEnabled) {
+            last = multigrid.addCycleTasks(graph, particles, [this](TaskGraph& g, TaskGraph::TaskId a) {
+                return springs.addJacobiTasks(g, particles, a);
+            }, last);
+            break;
         }
-        else if (currentCollisionShape == COLLISIONSHAPE::CUBE) {
-            collision = checkCubeCollision(p.position, penetrationDepth, normal);
+        last = springs.addJacobiTasks(graph, particles, last);
+        break;
+    case SOLVERMODE::XPBD:
+        last = springs.addXpbdTasks(graph, particles, dt, last);
+        break;
+    case SOLVERMODE::PROJECTIVE:
+        last = projective.addIterationTasks(graph, particles, springs, last);
+        break;
+    default:
+        if (multigridEnabled) {
+            last = multigrid.addCycleTasks(graph, particles, [this](TaskGraph& g, TaskGraph::TaskId a) {
+                return springs.addConstraintTasks(g, particles, a);
+            }, last);
+            break;
         }
+        last = springs.addConstraintTasks(graph, particles, last);
+        break;
+    }
 
-        if (collision) {
-            resolveCollision(p, normal, penetrationDepth);
+    // Before the collisions, so the extrapolation can't push through a collider
+    if (accelerate) {
+        last = accelerator.addTasks(graph, particles, last);
+    }
+
+    if (!colliders.empty()) {
+        TaskGraph::TaskId collisions = addParticleTasks(graph, [this](size_t begin, size_t end) {
+            handleCollisions(begin, end);
+        });
+        graph.precede(last, collisions);
+        last = collisions;
+    }
+
+    if (selfCollisionModes[static_cast<size_t>(currentMode)]) {
+        last = selfCollision.addSolveTasks(graph, particles, last);
+    }
+    return last;
+}
+
+TaskGraph::TaskId Simulation::addParticleTasks(TaskGraph& graph, TaskGraph::RangeFunction fn) {
+    if (sleepTiles.sleepingCount() == 0) {
+        return graph.addParallelFor(particles.size(), PARTICLE_GRAIN, std::move(fn));
+    }
+
+    // Runs are at least a tile wide, so this keeps chunks near the usual size
+    std::span<const ParticleRun> runs = sleepTiles.awakeRuns();
+    return graph.addParallelFor(runs.size(), PARTICLE_GRAIN / SLEEP_TILE_SIZE, [runs, fn = std::move(fn)](size_t begin, size_t end) {
+        for (size_t r = begin; r < end; ++r) {
+            fn(runs[r].begin, runs[r].end);
         }
+    });
+}
+
+void Simulation::wakeAll() {
+    if (sleepTiles.wakeAll(particles)) {
+        buildStepGraph();
     }
 }
 
-bool Simulation::checkSphereCollision(const glm::vec3& particlePos, float& penetrationDepth, glm::vec3& normal) {
-    glm::vec3 diff = particlePos - collisionObject.position;
-    float distance = glm::length(diff);
-    float clothThickness = 0.1f;
-    float radius = collisionObject.size.x + clothThickness;
+bool Simulation::accelerating() const {
+    // XPBD's multipliers only add up for positions its own sweeps produced
+    return accelerator.enabled() && currentSolver != SOLVERMODE::XPBD && currentStepMode != STEPMODE::SUBSTEPS;
+}
+
+bool Simulation::constraintsAreForces() const {
+    return currentSolver == SOLVERMODE::XPBD || currentSolver == SOLVERMODE::PROJECTIVE;
+}
 
-    if (distance < radius + 0.1f) { // Add small buffer
-        penetrationDepth = (radius + 0.05f) - distance;
-        normal = (distance > 0.0001f) ? glm::normalize(diff) : glm::vec3(0.0f, 1.0f, 0.0f);
-        return true;
+float Simulation::stepDt() const {
+    switch (currentStepMode) {
+    case STEPMODE::SUBSTEPS:
+        return FIXED_DT / static_cast<float>(substeps);
+    case STEPMODE::IMPLICIT:
+        return FIXED_DT * static_cast<float>(implicitScale);
+    default:
+        return FIXED_DT;
     }
-    return false;
 }
 
-bool Simulation::checkCubeCollision(const glm::vec3& particlePos, float& penetrationDepth, glm::vec3& normal) {
-    float clothThickness = 0.12f;
-    glm::vec3 halfSize = collisionObject.size * 0.5f + glm::vec3(clothThickness + 0.02f); // Add buffer
-    glm::vec3 diff = particlePos - collisionObject.position;
+float Simulation::stepLength() const {
+    // Substeps still add up to one fixed step
+    return currentStepMode == STEPMODE::IMPLICIT ? stepDt() : FIXED_DT;
+}
 
-    // Check if particle is inside the expanded cube
-    if (std::abs(diff.x) < halfSize.x && std::abs(diff.y) < halfSize.y && std::abs(diff.z) < halfSize.z) {
-        // Find the closest face
-        glm::vec3 distances = halfSize - glm::abs(diff);
-        float minDist = std::min({ distances.x, distances.y, distances.z });
+void Simulation::setStepping(STEPMODE mode, int count) {
+    float before = stepDt();
+    currentStepMode = mode;
+    if (mode == STEPMODE::IMPLICIT) {
+        implicitScale = std::clamp(count, 1, MAX_IMPLICIT_SCALE);
+    }
+    else if (mode == STEPMODE::SUBSTEPS) {
+        substeps = std::max(count, 1);
+    }
+    float after = stepDt();
 
-        if (minDist == distances.x) {
-            normal = glm::vec3(diff.x > 0 ? 1.0f : -1.0f, 0.0f, 0.0f);
-            penetrationDepth = distances.x;
-        }
-        else if (minDist == distances.y) {
-            normal = glm::vec3(0.0f, diff.y > 0 ? 1.0f : -1.0f, 0.0f);
-            penetrationDepth = distances.y;
+    // Verlet keeps velocity as the last step's displacement, so a new step
+    // length has to scale it to keep the cloth moving at the same speed
+    const float ratio = after / before;
+    for (size_t i = 0; i < particles.size(); ++i) {
+        particles.prevPositions[i] = particles.positions[i] - (particles.positions[i] - particles.prevPositions[i]) * ratio;
+    }
+
+    applySpringMaterials();
+    buildStepGraph();
+}
+
+void Simulation::applySpringMaterials() {
+    // The spring force kernels damp by the displacement over one step, so a
+    // shorter step needs a larger coefficient for the same damping per
+    // second. XPBD's damping term already accounts for the step length.
+    const float dampingScale = currentSolver == SOLVERMODE::XPBD ? 1.0f : FIXED_DT / stepDt();
+    springs.setMaterial(SPRINGTYPE::STRUCTURAL, k_structural, structural_damping * dampingScale);
+    springs.setMaterial(SPRINGTYPE::SHEAR, k_shear, shear_damping * dampingScale);
+    springs.setMaterial(SPRINGTYPE::BEND, k_bend, bend_damping * dampingScale);
+}
+
+int Simulation::runConstraintIterations() {
+    int iterations = 0;
+    float previousRms = 0.0f;
+    const bool accelerated = accelerating();
+    if (accelerated) {
+        accelerator.begin();
+    }
+    while (iterations < maxIterations) {
+        if (accelerated) {
+            accelerator.next();
         }
-        else {
-            normal = glm::vec3(0.0f, 0.0f, diff.z > 0 ? 1.0f : -1.0f);
-            penetrationDepth = distances.z;
+        jobs.run(iterationGraph);
+        ++iterations;
+        if (!adaptiveIterations) continue;
+
+        // Cloth resting under gravity never gets inside the tolerance: the
+        // clamp holds it up against a new sag every step. There the RMS
+        // barely moves from one sweep to the next, and that's the cue too.
+        lastResidual = springs.residual();
+        if (iterations >= minIterations &&
+            (lastResidual.max < residualTolerance || lastResidual.rms > previousRms * (1.0f - RESIDUAL_MIN_PROGRESS))) {
+            break;
         }
-        return true;
+        previousRms = lastResidual.rms;
     }
-    return false;
+    return iterations;
 }
 
-void Simulation::resolveCollision(Particle& particle, const glm::vec3& normal, float penetrationDepth) {
-    // Move particle out of collision object
-    particle.position += normal * penetrationDepth;
+void Simulation::updateWind() {
+    // The field follows simulation time, so a replay blows the same way
+    simulationTime += stepLength();
+    wind.advance(simulationTime);
+}
 
-    // Calculate current velocity from Verlet integration
-    glm::vec3 velocity = particle.position - particle.prevPosition;
-    float speed = glm::length(velocity);
+void Simulation::run() {
+    float accumulator = 0.0f;
+    lastFrameTime = SDL_GetPerformanceCounter();
 
-    // Decompose velocity into normal and tangential components
-    float normalVel = glm::dot(velocity, normal);
-    glm::vec3 normalComponent = normalVel * normal;
-    glm::vec3 tangentialComponent = velocity - normalComponent;
-    float tangentialSpeed = glm::length(tangentialComponent);
+    while (running) {
+        Uint64 currentFrameTime = SDL_GetPerformanceCounter();
+        deltaTime = (float)(currentFrameTime - lastFrameTime) / SDL_GetPerformanceFrequency();
+        lastFrameTime = currentFrameTime;
+        deltaTime = glm::min(deltaTime, 1.0f / 60.0f);
+        accumulator += deltaTime;
 
-    // Washcloth parameters
-    const float staticFriction = 0.9f;      // Washcloth grips surfaces
-    const float kineticFriction = 0.7f;     // Lower when already moving
-    const float dampening = 0.85f;          // Absorb energy like fabric
-    const float restitution = 0.02f;        // Minimal bounce
-    const float gripThreshold = 0.5f;       // Speed below which static friction kicks in
+        processEvent();
+        if (currentMode == SIMMODE::FLAG) {
+            if (currentPinning != PINNINGMODE::FLAG) {
+                currentPinning = PINNINGMODE::FLAG;
+                applyPinning();
+            }
+        }
+        handleMouseActivity();
 
-    // Handle normal component (into/out of surface)
-    glm::vec3 newNormalComponent;
-    if (normalVel < 0) { 
-        newNormalComponent = -normalVel * restitution * normal;
-    }
-    else {
-        newNormalComponent = normalVel * normal * 0.95f;
-    }
+        const float step = stepLength();
+        pendingSteps = 0;
+        while (accumulator >= step) {
+            ++pendingSteps;
+            accumulator -= step;
+        }
 
-    // Handle tangential component (sliding along surface)
-    glm::vec3 newTangentialComponent;
+        // Nothing moves until something wakes the cloth
+        if (sleepTiles.allAsleep()) {
+            pendingSteps = 0;
+        }
 
-    if (tangentialSpeed < gripThreshold) {
-        // Static Friction
-        newTangentialComponent = tangentialComponent * (1.0f - staticFriction);
-    }
-    else {
-        // Kinetic Friction
-        if (tangentialSpeed > 0.0001f) {
-            glm::vec3 tangentialDirection = tangentialComponent / tangentialSpeed;
-            float newTangentialSpeed = tangentialSpeed * (1.0f - kineticFriction);
-            newTangentialComponent = tangentialDirection * newTangentialSpeed;
+        // Physics runs on the workers while this thread issues the GL work
+        // for the previous step's positions. Nothing may touch the particles
+        // or springs until the frame graph has finished.
+        if (pendingSteps > 0) {
+            // Gravity is applied as an acceleration during integration
+            stepGravity = (currentMode == SIMMODE::COLLISION)
+                ? glm::vec3(0.0f, -3.0f, 0.0f)
+                : glm::vec3(0.0f, -9.81f, 0.0f);
+            particleGridCurrent = false;
+
+            // The flag's triangles are oriented by the normals drawn last
+            // frame; this frame draws into the other buffer
+            aerodynamics.setNormals(renderNormals[drawnNormals].data());
+            drawnNormals = 1 - drawnNormals;
+            jobs.submit(frameGraph);
+        }
+
+        render();
+
+        jobs.wait(frameGraph);
+        if (sleepEnabled && pendingSteps > 0 && sleepTiles.update(particles, pendingSteps, stepDt())) {
+            buildStepGraph();
+        }
+        if (currentStepMode == STEPMODE::IMPLICIT) {
+            // Implicit steps span several frames; drawing the cloth between
+            // the last two states hides that. The collisions rewrite
+            // prevPositions for friction, so the start comes from the solver.
+            const float blend = accumulator / step;
+            const AlignedVector<glm::vec3>& start = implicit.getStartPositions();
+            for (size_t i = 0; i < particles.size(); ++i) {
+                renderPositions[i] = glm::mix(start[i], particles.positions[i], blend);
+            }
         }
         else {
-            newTangentialComponent = glm::vec3(0.0f);
+            std::copy(particles.positions.begin(), particles.positions.end(), renderPositions.begin());
         }
+
+        renderGUI();
+
+        SDL_GL_SwapWindow(window);
     }
+    clean();
+}
+
+void Simulation::handleCollisions(size_t begin, size_t end) {
+    colliders.collide(particles, begin, end);
+}
+
+void Simulation::rebuildColliders() {
+    // Cloth resting on the old shapes may have nothing under it now
+    wakeAll();
+    colliders.clear();
+
+    switch (currentMode) {
+    case SIMMODE::COLLISION:
+        // Contact offsets keep the washcloth a little off the surface
+        switch (currentCollisionShape) {
+        case COLLISIONSHAPE::SPHERE:
+            colliders.addSphere(collisionObject.position, collisionObject.size.x + 0.15f, 0.05f);
+            break;
+        case COLLISIONSHAPE::SPHERE_MESH:
+            if (!sphereMesh.empty()) {
+                colliders.addMesh(sphereMesh, collisionObject.position, 0.15f, 0.05f);
+            }
+            break;
+        default:
+            if (!cubeSdf.empty()) {
+                colliders.addSdf(cubeSdf, collisionObject.position, 0.14f);
+            }
+            else {
+                colliders.addBox(collisionObject.position, collisionObject.size * 0.5f + glm::vec3(0.14f));
+            }
+            break;
+        }
+        break;
 
-    // Combine components with overall dampening
-    glm::vec3 newVelocity = (newNormalComponent + newTangentialComponent) * dampening;
+    case SIMMODE::FLAG:
+        // The pinned edge runs down the pole's axis, so the collider is
+        // thinner than the drawn pole and clears the next column of the flag
+        colliders.addCapsule(glm::vec3(0.0f, -20.0f, 0.0f), glm::vec3(0.0f), spacing * 0.5f);
+        break;
+
+    default:
+        break;
+    }
 
-    // Update previous position based on new velocity
-    particle.prevPosition = particle.position - newVelocity;
+    colliders.update();
 }
 
 void Simulation::reset() {
@@ -403,12 +655,16 @@ void Simulation::reset() {
                 originalPos = glm::vec3(x * spacing, -y * spacing, 0.0f);
             }
 
-            particles[idx].position = originalPos;
-            particles[idx].prevPosition = originalPos;
-            particles[idx].acceleration = glm::vec3(0.0f);
+            particles.positions[idx] = originalPos;
+            particles.prevPositions[idx] = originalPos;
+            particles.forces[idx] = glm::vec3(0.0f);
         }
     }
 
+    std::copy(particles.positions.begin(), particles.positions.end(), renderPositions.begin());
+    particleGridCurrent = false;
+    simulationTime = 0.0f;
+
     collisionObject.position = glm::vec3((cols - 1) * spacing * 0.5f, -5.0f, -2.0f);
 
     if (currentMode == SIMMODE::COLLISION) {
@@ -418,7 +674,11 @@ void Simulation::reset() {
     
     applyPinning();
 
-    std::fill(springActive.begin(), springActive.end(), true);
+    springs.activateAll();
+    multigrid.activateAll();
+    projective.invalidate();
+    rebuildColliders();
+    buildStepGraph();
 
     switch (currentMode) {
     case SIMMODE::TEAR:
@@ -591,6 +851,7 @@ bool Simulation::init() {
     initSprings();
     initClothMesh();
     initFlagMesh();
+    allocateMeshBuffers();
     initCollisionObjects();
     initSkybox();
     initUBO();
@@ -669,6 +930,19 @@ void Simulation::initSkybox() {
 void Simulation::initCollisionObjects() {
     // Generate cube
     cube = MeshGenerator::generateCube(1.0f);
+
+    // Bake the cube's distance field, or load it from an earlier run
+    cubeMesh.build(cube, collisionObject.size);
+    char* prefPath = SDL_GetPrefPath("example", "ClothSimGL");
+    if (prefPath) {
+        if (!cubeSdf.bakeCached(cubeMesh, SDF_CELL_SIZE, SDF_PADDING, fs::path(prefPath) / "cube.sdf", jobs)) {
+            SDL_Log("Could not write the collider cache to %s", prefPath);
+        }
+        SDL_free(prefPath);
+    }
+    else {
+        cubeSdf.bake(cubeMesh, SDF_CELL_SIZE, SDF_PADDING, jobs);
+    }
     glGenVertexArrays(1, &cubeVAO);
     glGenBuffers(1, &cubeVBO);
 
@@ -685,6 +959,7 @@ void Simulation::initCollisionObjects() {
 
     // Generate sphere
     sphere = MeshGenerator::generateSphere(1.0f, 20, 20);
+    sphereMesh.build(sphere, collisionObject.size);
     glGenVertexArrays(1, &sphereVAO);
     glGenBuffers(1, &sphereVBO);
 
@@ -721,8 +996,6 @@ void Simulation::initParticle() {
 
     glBindVertexArray(particleVAO);
     glBindBuffer(GL_ARRAY_BUFFER, particleVBO);
-    glBufferData(GL_ARRAY_BUFFER, particles.size() * sizeof(glm::vec3), nullptr, GL_DYNAMIC_DRAW);
-
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, (void*)0);
     glEnableVertexAttribArray(0);
 
@@ -736,9 +1009,6 @@ void Simulation::initSprings() {
 
     glBindVertexArray(springVAO);
     glBindBuffer(GL_ARRAY_BUFFER, springVBO);
-
-    glBufferData(GL_ARRAY_BUFFER, springs.size() * 2 * sizeof(glm::vec3), nullptr, GL_DYNAMIC_DRAW);
-
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, (void*)0);
     glEnableVertexAttribArray(0);
 
@@ -752,32 +1022,62 @@ void Simulation::initClothMesh() {
     // Position VBO
     glGenBuffers(1, &clothVBO);
     glBindBuffer(GL_ARRAY_BUFFER, clothVBO);
-    glBufferData(GL_ARRAY_BUFFER, particles.size() * sizeof(glm::vec3), nullptr, GL_DYNAMIC_DRAW);
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), (void*)0);
     glEnableVertexAttribArray(0);
 
     // TexCoord VBO
     glGenBuffers(1, &clothTexVBO);
     glBindBuffer(GL_ARRAY_BUFFER, clothTexVBO);
-    glBufferData(GL_ARRAY_BUFFER, clothTexCoords.size() * sizeof(glm::vec2), clothTexCoords.data(), GL_STATIC_DRAW);
     glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(glm::vec2), (void*)0);
     glEnableVertexAttribArray(1);
 
     // Normal VBO
     glGenBuffers(1, &clothNormVBO);
     glBindBuffer(GL_ARRAY_BUFFER, clothNormVBO);
-    glBufferData(GL_ARRAY_BUFFER, particles.size() * sizeof(glm::vec3), nullptr, GL_DYNAMIC_DRAW);
     glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), (void*)0);
     glEnableVertexAttribArray(2);
 
     // EBO
     glGenBuffers(1, &clothEBO);
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, clothEBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, clothIndices.size() * sizeof(unsigned int), clothIndices.data(), GL_STATIC_DRAW);
 
     glBindVertexArray(0);
 }
 
+void Simulation::allocateMeshBuffers() {
+    // The buffers keep their names and attribute layouts; only their storage
+    // follows the cloth's size. Positions and normals are streamed in every
+    // frame, so they start empty.
+    const GLsizeiptr vertexBytes = particles.size() * sizeof(glm::vec3);
+
+    glBindBuffer(GL_ARRAY_BUFFER, particleVBO);
+    glBufferData(GL_ARRAY_BUFFER, vertexBytes, nullptr, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, springVBO);
+    glBufferData(GL_ARRAY_BUFFER, springs.size() * 2 * sizeof(glm::vec3), nullptr, GL_DYNAMIC_DRAW);
+
+    glBindBuffer(GL_ARRAY_BUFFER, clothVBO);
+    glBufferData(GL_ARRAY_BUFFER, vertexBytes, nullptr, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, clothTexVBO);
+    glBufferData(GL_ARRAY_BUFFER, clothTexCoords.size() * sizeof(glm::vec2), clothTexCoords.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, clothNormVBO);
+    glBufferData(GL_ARRAY_BUFFER, vertexBytes, nullptr, GL_DYNAMIC_DRAW);
+
+    glBindBuffer(GL_ARRAY_BUFFER, flagVBO);
+    glBufferData(GL_ARRAY_BUFFER, vertexBytes, nullptr, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, flagTexVBO);
+    glBufferData(GL_ARRAY_BUFFER, flagTexCoords.size() * sizeof(glm::vec2), flagTexCoords.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, flagNormVBO);
+    glBufferData(GL_ARRAY_BUFFER, vertexBytes, nullptr, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    // Element buffers belong to their vertex array, so it has to be bound
+    glBindVertexArray(clothVAO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, clothIndices.size() * sizeof(unsigned int), clothIndices.data(), GL_STATIC_DRAW);
+    glBindVertexArray(flagVAO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, flagIndices.size() * sizeof(unsigned int), flagIndices.data(), GL_STATIC_DRAW);
+    glBindVertexArray(0);
+}
+
 void Simulation::initFlagMesh() {
 
     // flag
@@ -787,28 +1087,24 @@ void Simulation::initFlagMesh() {
     // Position VBO
     glGenBuffers(1, &flagVBO);
     glBindBuffer(GL_ARRAY_BUFFER, flagVBO);
-    glBufferData(GL_ARRAY_BUFFER, particles.size() * sizeof(glm::vec3), nullptr, GL_DYNAMIC_DRAW);
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), (void*)0);
     glEnableVertexAttribArray(0);
 
     // TexCoord VBO
     glGenBuffers(1, &flagTexVBO);
     glBindBuffer(GL_ARRAY_BUFFER, flagTexVBO);
-    glBufferData(GL_ARRAY_BUFFER, flagTexCoords.size() * sizeof(glm::vec2), flagTexCoords.data(), GL_STATIC_DRAW);
     glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(glm::vec2), (void*)0);
     glEnableVertexAttribArray(1);
 
     // Normal VBO
     glGenBuffers(1, &flagNormVBO);
     glBindBuffer(GL_ARRAY_BUFFER, flagNormVBO);
-    glBufferData(GL_ARRAY_BUFFER, particles.size() * sizeof(glm::vec3), nullptr, GL_DYNAMIC_DRAW);
     glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), (void*)0);
     glEnableVertexAttribArray(2);
 
     // EBO
     glGenBuffers(1, &flagEBO);
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, flagEBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, flagIndices.size() * sizeof(unsigned int), flagIndices.data(), GL_STATIC_DRAW);
 
     glBindVertexArray(0);
 
@@ -857,36 +1153,56 @@ void Simulation::handleMouseActivity() {
     }
 }
 
+void Simulation::rebuildParticleGrid() {
+    // Cells as wide as the pick distance, so picking only looks one cell out
+    particleGrid.build(particles.positions.data(), particles.size(), std::max(tearRadius * 2.0f, spacing));
+    particleGridCurrent = true;
+}
+
 void Simulation::handleMouseTearing() {
     if (leftMouseDown) {
+        // The frame graph only rehashes while the mouse is held
+        if (!particleGridCurrent) {
+            rebuildParticleGrid();
+        }
+
         glm::vec3 nearPoint = screenToWorld(mousePos, 0.0f);
         glm::vec3 farPoint = screenToWorld(mousePos, 1.0f);
         glm::vec3 rayDir = glm::normalize(farPoint - nearPoint);
 
-        Particle* targetParticle = findClosestParticleToRay(nearPoint, rayDir);
+        int targetParticle = findClosestParticleToRay(nearPoint, rayDir);
 
-        if (targetParticle != nullptr) {
-            tearSpringsAroundPoint(targetParticle->position, tearRadius);
+        if (targetParticle >= 0) {
+            tearSpringsAroundPoint(particles.positions[targetParticle], tearRadius);
         }
     }
 }
 
 void Simulation::tearSpringsAroundPoint(glm::vec3 worldPos, float radius) {
-    int tornCount = 0;
-
-    for (size_t i = 0; i < springs.size(); ++i) {
-        if (!springActive[i]) continue;
+    // A spring passing within the radius has its nearer end within radius
+    // plus half its length. Constraints keep springs near their rest length,
+    // so a full rest length of slack covers it.
+    float reach = radius + springs.getMaxRestLength();
+    float reachSq = reach * reach;
+
+    std::vector<uint32_t> candidates;
+    particleGrid.forEachCandidate(worldPos, reach, [&](uint32_t i) {
+        glm::vec3 offset = particles.positions[i] - worldPos;
+        if (glm::dot(offset, offset) < reachSq) {
+            std::span<const uint32_t> attached = springs.springsOf(i);
+            candidates.insert(candidates.end(), attached.begin(), attached.end());
+        }
+    });
 
-        glm::vec3 p1 = springs[i].p1->position;
-        glm::vec3 p2 = springs[i].p2->position;
+    size_t tornCount = springs.tearWhere(candidates, [&](const Spring& s) {
+        glm::vec3 p1 = particles.positions[s.p1];
+        glm::vec3 p2 = particles.positions[s.p2];
 
         float dist1 = glm::length(worldPos - p1);
         float dist2 = glm::length(worldPos - p2);
 
         if (dist1 < radius || dist2 < radius) {
-            springActive[i] = false;
-            tornCount++;
-            continue;
+            return true;
         }
 
         glm::vec3 springVec = p2 - p1;
@@ -902,42 +1218,29 @@ void Simulation::tearSpringsAroundPoint(glm::vec3 worldPos, float radius) {
             float distanceToTear = glm::length(worldPos - closestPoint);
 
             if (distanceToTear < radius) {
-                springActive[i] = false;
-                tornCount++;
+                return true;
             }
         }
+        return false;
+    });
+
+    // The step graph holds the old live ranges, and the projective solver's
+    // factorization the old springs; it's redone at the next step
+    if (tornCount > 0) {
+        multigrid.tear(springs);
+        projective.invalidate();
+        sleepTiles.wakeAll(particles);
+        buildStepGraph();
     }
-
 }
 
-Particle* Simulation::findClosestParticleToRay(glm::vec3 rayOrigin, glm::vec3 rayDir) {
-    float min_dist_sq = std::numeric_limits<float>::max();
-    Particle* closest_particle = nullptr;
-
+int Simulation::findClosestParticleToRay(glm::vec3 rayOrigin, glm::vec3 rayDir) {
     if (particles.empty()) {
-        return nullptr;
-    }
-
-    for (auto& p : particles) {
-
-        glm::vec3 vec_to_particle = p.position - rayOrigin;
-
-        glm::vec3 closest_point_on_ray = rayOrigin + glm::dot(vec_to_particle, rayDir) * rayDir;
-
-        glm::vec3 vec = p.position - closest_point_on_ray;
-        float dist_sq = glm::dot(vec, vec);
-
-        if (dist_sq < min_dist_sq) {
-            min_dist_sq = dist_sq;
-            closest_particle = &p;
-        }
-    }
-
-    if (closest_particle && sqrt(min_dist_sq) < tearRadius * 2.0f) {
-        return closest_particle;
+        return -1;
     }
 
-    return nullptr;
+    // Clicks further than twice the tear radius from the cloth miss it
+    return particleGrid.closestToRay(particles.positions.data(), rayOrigin, rayDir, tearRadius * 2.0f);
 }
 
 void Simulation::processEvent() {
@@ -1017,6 +1320,7 @@ void Simulation::processEvent() {
             case SDLK_C:
                 if (currentMode == SIMMODE::COLLISION) {
                     currentCollisionShape = static_cast<COLLISIONSHAPE>((static_cast<int>(currentCollisionShape) + 1) % static_cast<int>(COLLISIONSHAPE::LAST));
+                    rebuildColliders();
                 }
                 break;
             case SDLK_SPACE:
@@ -1062,16 +1366,17 @@ void Simulation::processEvent() {
     }
 }
 
-std::vector<glm::vec3> Simulation::computeNormals(const std::vector<unsigned int>& indices) {
-    std::vector<glm::vec3> normals(particles.size(), glm::vec3(0.0f));
+void Simulation::computeNormals(const std::vector<unsigned int>& indices, std::vector<glm::vec3>& normals) {
+    normals.assign(renderPositions.size(), glm::vec3(0.0f));
+    const glm::vec3* positions = renderPositions.data();
     // Accumulate per-triangle normals
     for (size_t i = 0; i < indices.size(); i += 3) {
         unsigned int ia = indices[i + 0];
         unsigned int ib = indices[i + 1];
         unsigned int ic = indices[i + 2];
-        const glm::vec3& a = particles[ia].position;
-        const glm::vec3& b = particles[ib].position;
-        const glm::vec3& c = particles[ic].position;
+        const glm::vec3& a = positions[ia];
+        const glm::vec3& b = positions[ib];
+        const glm::vec3& c = positions[ic];
         glm::vec3 n = glm::normalize(glm::cross(b - a, c - a));
         normals[ia] += n;
         normals[ib] += n;
@@ -1083,7 +1388,6 @@ std::vector<glm::vec3> Simulation::computeNormals(const std::vector<unsigned int
         if (len > 1e-6f) n /= len;
         else n = glm::vec3(0, 0, 1);
     }
-    return normals;
 }
 
 void Simulation::render() {
@@ -1116,22 +1420,20 @@ void Simulation::render() {
     case SIMMODE::TEAR:
     {
         particleShader.use();
-        std::vector<glm::vec3> activeSpringPositions;
-        activeSpringPositions.reserve(springs.size() * 2);
+        springLines.resize(springs.liveCount() * 2);
 
-        for (size_t i = 0; i < springs.size(); ++i) {
-            if (springActive[i]) {
-                activeSpringPositions.emplace_back(springs[i].p1->position);
-                activeSpringPositions.emplace_back(springs[i].p2->position);
-            }
-        }
+        size_t line = 0;
+        springs.forEachLive([&](const Spring& s) {
+            springLines[line++] = renderPositions[s.p1];
+            springLines[line++] = renderPositions[s.p2];
+        });
 
-        if (!activeSpringPositions.empty()) {
+        if (!springLines.empty()) {
             glBindBuffer(GL_ARRAY_BUFFER, springVBO);
-            glBufferSubData(GL_ARRAY_BUFFER, 0, activeSpringPositions.size() * sizeof(glm::vec3), activeSpringPositions.data());
+            glBufferSubData(GL_ARRAY_BUFFER, 0, springLines.size() * sizeof(glm::vec3), springLines.data());
             particleShader.setVec3("color", glm::vec3(0.8f, 0.8f, 0.8f));
             glBindVertexArray(springVAO);
-            glDrawArrays(GL_LINES, 0, activeSpringPositions.size());
+            glDrawArrays(GL_LINES, 0, springLines.size());
             glBindVertexArray(0);
         }
 
@@ -1156,16 +1458,12 @@ void Simulation::render() {
         glm::mat4 clothModel = glm::mat4(1.0f);
         clothShader.setMat4("model", clothModel);
 
-        std::vector<glm::vec3> positions;
-        positions.reserve(particles.size());
-        for (auto& p : particles) {
-            positions.emplace_back(p.position);
-        }
         glBindBuffer(GL_ARRAY_BUFFER, clothVBO);
-        glBufferSubData(GL_ARRAY_BUFFER, 0, positions.size() * sizeof(glm::vec3), positions.data());
+        glBufferSubData(GL_ARRAY_BUFFER, 0, renderPositions.size() * sizeof(glm::vec3), renderPositions.data());
 
         // Update normals
-        std::vector<glm::vec3> normals = computeNormals(clothIndices);
+        std::vector<glm::vec3>& normals = renderNormals[drawnNormals];
+        computeNormals(clothIndices, normals);
         glBindBuffer(GL_ARRAY_BUFFER, clothNormVBO);
         glBufferSubData(GL_ARRAY_BUFFER, 0, normals.size() * sizeof(glm::vec3), normals.data());
 
@@ -1263,16 +1561,12 @@ void Simulation::render() {
         glm::mat4 flagModel = glm::mat4(1.0f);
         flagShader.setMat4("model", flagModel);
 
-        std::vector<glm::vec3> positions;
-        positions.reserve(particles.size());
-        for (auto& p : particles) {
-            positions.emplace_back(p.position);
-        }
         glBindBuffer(GL_ARRAY_BUFFER, flagVBO);
-        glBufferSubData(GL_ARRAY_BUFFER, 0, positions.size() * sizeof(glm::vec3), positions.data());
+        glBufferSubData(GL_ARRAY_BUFFER, 0, renderPositions.size() * sizeof(glm::vec3), renderPositions.data());
 
         // Update normals
-        std::vector<glm::vec3> normals = computeNormals(flagIndices);
+        std::vector<glm::vec3>& normals = renderNormals[drawnNormals];
+        computeNormals(flagIndices, normals);
         glBindBuffer(GL_ARRAY_BUFFER, flagNormVBO);
         glBufferSubData(GL_ARRAY_BUFFER, 0, normals.size() * sizeof(glm::vec3), normals.data());
 
@@ -1296,9 +1590,6 @@ void Simulation::render() {
     }
     }
 
-    renderGUI();
-
-    SDL_GL_SwapWindow(window);
 }
 
 void Simulation::renderGUI() {
@@ -1350,16 +1641,162 @@ void Simulation::renderGUI() {
 
     // Collision Shape
     if (currentMode == SIMMODE::COLLISION) {
-        const char* shapes[] = { "Cube", "Sphere" };
+        const char* shapes[] = { "Cube", "Sphere", "Sphere Mesh" };
         int shapeInt = static_cast<int>(currentCollisionShape);
-        if (ImGui::Combo("Collision Shape", &shapeInt, shapes, 2)) {
+        if (ImGui::Combo("Collision Shape", &shapeInt, shapes, 3)) {
             currentCollisionShape = static_cast<COLLISIONSHAPE>(shapeInt);
+            rebuildColliders();
+        }
+    }
+
+    // Anything that changes the forces or how the cloth responds to them
+    // wakes it, since a resting cloth has no motion of its own to wake it
+    bool disturbed = false;
+
+    // Constraint Solver
+    const char* solvers[] = { "Gauss-Seidel", "Jacobi", "XPBD", "Projective Dynamics" };
+    int solverInt = static_cast<int>(currentSolver);
+    if (ImGui::Combo("Constraint Solver", &solverInt, solvers, 4)) {
+        currentSolver = static_cast<SOLVERMODE>(solverInt);
+        applySpringMaterials();
+        buildStepGraph();
+        disturbed = true;
+    }
+
+    if (currentSolver == SOLVERMODE::JACOBI) {
+        disturbed |= ImGui::SliderFloat("Over-relaxation", &springs.jacobiRelaxation, 1.0f, 2.0f);
+    }
+
+    // Each iteration becomes a V-cycle over the coarse levels
+    if ((currentSolver == SOLVERMODE::GAUSS_SEIDEL || currentSolver == SOLVERMODE::JACOBI) &&
+        ImGui::Checkbox("Multigrid", &multigridEnabled)) {
+        buildStepGraph();
+    }
+
+    if (constraintsAreForces()) {
+        disturbed |= ImGui::SliderFloat("Structural Compliance", &springs.compliance[static_cast<size_t>(SPRINGTYPE::STRUCTURAL)], 1e-8f, 1e-2f, "%.1e", ImGuiSliderFlags_Logarithmic);
+        disturbed |= ImGui::SliderFloat("Shear Compliance", &springs.compliance[static_cast<size_t>(SPRINGTYPE::SHEAR)], 1e-8f, 1e-2f, "%.1e", ImGuiSliderFlags_Logarithmic);
+        disturbed |= ImGui::SliderFloat("Bend Compliance", &springs.compliance[static_cast<size_t>(SPRINGTYPE::BEND)], 1e-8f, 1e-2f, "%.1e", ImGuiSliderFlags_Logarithmic);
+    }
+
+    // Iterations after one step, one sweep per substep, or an implicit solve
+    const char* stepModes[] = { "Iterations", "Substeps", "Implicit" };
+    int stepModeInt = static_cast<int>(currentStepMode);
+    if (ImGui::Combo("Stepping", &stepModeInt, stepModes, 3)) {
+        STEPMODE mode = static_cast<STEPMODE>(stepModeInt);
+        setStepping(mode, mode == STEPMODE::IMPLICIT ? implicitScale : substeps);
+        disturbed = true;
+    }
+
+    const bool iterating = currentStepMode != STEPMODE::SUBSTEPS;
+    if (currentStepMode == STEPMODE::SUBSTEPS) {
+        int substepCount = substeps;
+        if (ImGui::SliderInt("Substeps", &substepCount, 2, CONSTRAINT_ITERATIONS * 2)) {
+            setStepping(currentStepMode, substepCount);
+        }
+    }
+    else if (currentStepMode == STEPMODE::IMPLICIT) {
+        int scale = implicitScale;
+        if (ImGui::SliderInt("Step Length", &scale, 1, MAX_IMPLICIT_SCALE, "%d fixed steps")) {
+            setStepping(currentStepMode, scale);
+        }
+        ImGui::SliderFloat("CG Tolerance", &implicit.tolerance, 1e-5f, 1e-1f, "%.1e", ImGuiSliderFlags_Logarithmic);
+    }
+
+    if (iterating && ImGui::Checkbox("Adaptive Iterations", &adaptiveIterations)) {
+        buildStepGraph();
+    }
+
+    if (iterating && adaptiveIterations) {
+        ImGui::SliderFloat("Residual Tolerance", &residualTolerance, 1e-5f, 1e-1f, "%.1e", ImGuiSliderFlags_Logarithmic);
+        if (ImGui::SliderInt("Min Iterations", &minIterations, 1, CONSTRAINT_ITERATIONS * 2)) {
+            maxIterations = std::max(maxIterations, minIterations);
         }
     }
+    if (iterating && ImGui::SliderInt("Max Iterations", &maxIterations, 1, CONSTRAINT_ITERATIONS * 2)) {
+        minIterations = std::min(minIterations, maxIterations);
+    }
+
+    // Extrapolation over the iterations; XPBD keeps its plain sweeps
+    if (iterating && currentSolver != SOLVERMODE::XPBD) {
+        const char* accelerations[] = { "None", "Chebyshev", "Anderson" };
+        int accelerationInt = static_cast<int>(accelerator.mode);
+        if (ImGui::Combo("Acceleration", &accelerationInt, accelerations, 3)) {
+            accelerator.mode = static_cast<ACCELERATION>(accelerationInt);
+            buildStepGraph();
+        }
+
+        if (accelerator.mode == ACCELERATION::CHEBYSHEV) {
+            ImGui::SliderFloat("Spectral Radius", &accelerator.spectralRadius, 0.5f, 0.999f, "%.3f");
+            ImGui::SliderFloat("Under-relaxation", &accelerator.underRelaxation, 0.5f, 1.0f);
+            ImGui::SliderInt("Delay", &accelerator.delay, 1, CONSTRAINT_ITERATIONS);
+        }
+        else if (accelerator.mode == ACCELERATION::ANDERSON &&
+            ImGui::SliderInt("Window", &accelerator.window, 1, MAX_ANDERSON_WINDOW)) {
+            // The history buffers are sized by the window
+            buildStepGraph();
+        }
+    }
+
+    // Self Collision, per mode
+    if (ImGui::Checkbox("Self Collision", &selfCollisionModes[static_cast<size_t>(currentMode)])) {
+        buildStepGraph();
+    }
+
+    if (selfCollisionModes[static_cast<size_t>(currentMode)]) {
+        ImGui::SliderFloat("Cloth Thickness", &selfCollision.thickness, spacing * 0.5f, spacing * 2.0f);
+    }
+
+    // Sleeping for cloth that has come to rest
+    if (ImGui::Checkbox("Sleeping", &sleepEnabled) && !sleepEnabled) {
+        wakeAll();
+    }
+
+    if (sleepEnabled) {
+        ImGui::SliderFloat("Sleep Speed", &sleepTiles.sleepSpeed, 0.001f, 0.1f, "%.3f", ImGuiSliderFlags_Logarithmic);
+    }
+
+    // Continuous collision against the scene's colliders
+    if (!colliders.empty() && ImGui::Checkbox("Continuous Collision", &continuousCollision)) {
+        buildStepGraph();
+    }
+
+    // Wind field for the flag
+    if (currentMode == SIMMODE::FLAG) {
+        disturbed |= ImGui::SliderFloat("Wind Speed", &wind.meanSpeed, 0.0f, 20.0f, "%.1f m/s");
+        disturbed |= ImGui::SliderFloat("Gustiness", &wind.gustiness, 0.0f, 1.0f);
+        disturbed |= ImGui::SliderFloat("Turbulence", &wind.turbulence, 0.0f, 10.0f, "%.1f m/s");
+        disturbed |= ImGui::SliderFloat("Swirl Size", &wind.scale, 0.5f, 10.0f, "%.1f m");
+        disturbed |= ImGui::SliderFloat("Swirl Change", &wind.evolution, 0.0f, 2.0f, "%.2f /s");
+        disturbed |= ImGui::SliderFloat("Drag", &aerodynamics.drag, 0.0f, 100.0f);
+        disturbed |= ImGui::SliderFloat("Lift", &aerodynamics.lift, 0.0f, 100.0f);
+        disturbed |= ImGui::SliderFloat("Skin Friction", &aerodynamics.friction, 0.0f, 50.0f);
+        int windSeed = static_cast<int>(wind.seed);
+        if (ImGui::InputInt("Wind Seed", &windSeed)) {
+            wind.seed = static_cast<uint32_t>(windSeed);
+            wind.invalidate();
+            disturbed = true;
+        }
+    }
+
+    if (disturbed) {
+        wakeAll();
+    }
 
     // Tear radius 
     if (currentMode == SIMMODE::TEAR) {
         ImGui::SliderFloat("Tear Radius", &tearRadius, 0.05f, 0.5f);
+        ImGui::SetItemTooltip("Clicks tear around the particle nearest the cursor, if one is within twice this radius of it");
+    }
+
+    // Cloth resolution; applied on Enter, since each change rebuilds the cloth
+    int resolution[2] = { cols, rows };
+    if (ImGui::InputInt2("Columns, Rows", resolution, ImGuiInputTextFlags_EnterReturnsTrue)) {
+        resizeCloth(resolution[1], resolution[0], spacing);
+    }
+    float newSpacing = spacing;
+    if (ImGui::InputFloat("Spacing", &newSpacing, 0.0f, 0.0f, "%.4f", ImGuiInputTextFlags_EnterReturnsTrue)) {
+        resizeCloth(rows, cols, newSpacing);
     }
 
     // Reset button
@@ -1393,7 +1830,37 @@ void Simulation::renderGUI() {
     ImGui::Separator();
     ImGui::Text("Physics:");
     ImGui::Text("- Particles: %d", static_cast<int>(particles.size()));
-    ImGui::Text("- Springs: %d", static_cast<int>(springs.size()));
+    ImGui::Text("- Springs: %d (%d intact)", static_cast<int>(springs.size()), static_cast<int>(springs.liveCount()));
+    ImGui::Text("- Spring Kernels: %s", SpringKernels::isaName(springs.getISA()));
+    ImGui::Text("- Spring Colors: %d", static_cast<int>(springs.colorCount()));
+    if (multigridEnabled && (currentSolver == SOLVERMODE::GAUSS_SEIDEL || currentSolver == SOLVERMODE::JACOBI)) {
+        ImGui::Text("- Multigrid: %d coarse levels", static_cast<int>(multigrid.levelCount()));
+    }
+    if (accelerating() && accelerator.mode == ACCELERATION::CHEBYSHEV) {
+        ImGui::Text("- Chebyshev weight: %.3f", accelerator.getOmega());
+    }
+    else if (accelerating() && accelerator.mode == ACCELERATION::ANDERSON) {
+        ImGui::Text("- Anderson history: %d", accelerator.getHistory());
+    }
+    if (currentSolver == SOLVERMODE::PROJECTIVE) {
+        ImGui::Text("- Cholesky Factor: %d nonzeros, %d factorizations", static_cast<int>(projective.factorNonZeros()), projective.getFactorizations());
+    }
+    if (currentStepMode == STEPMODE::SUBSTEPS) {
+        ImGui::Text("- Substeps: %d per step, one sweep each", substeps);
+    }
+    else {
+        ImGui::Text("- Iterations: %.1f per step", lastIterations);
+    }
+    if (currentStepMode == STEPMODE::IMPLICIT) {
+        ImGui::Text("- CG: %d iterations, %.1e residual", implicit.getIterations(), implicit.getResidual());
+    }
+    if (currentStepMode != STEPMODE::SUBSTEPS && adaptiveIterations) {
+        ImGui::Text("- Residual: %.1e max, %.1e RMS", lastResidual.max, lastResidual.rms);
+    }
+    if (sleepEnabled) {
+        ImGui::Text("- Sleeping Tiles: %d / %d", static_cast<int>(sleepTiles.sleepingCount()), static_cast<int>(sleepTiles.tileCount()));
+    }
+    ImGui::Text("- Worker Threads: %d%s", static_cast<int>(jobs.getWorkerCount()), jobs.arePinned() ? " (pinned)" : "");
     ImGui::Text("- Structural Springs: %.2f", k_structural);
     ImGui::Text("- Shear Springs: %.2f", k_shear);
     ImGui::Text("- Bend Springs: %.2f", k_bend);
@@ -0,0 +1,141 @@
+#include "sleeptiles.hpp"
+#include <algorithm>
+#include <cmath>
+
+SleepTiles::SleepTiles()
+    : sleepSpeed(0.01f)
+    , wakeSpeed(0.1f)
+    , sleepSteps(60)
+    , rows(0)
+    , cols(0)
+    , tilesX(0)
+    , tilesY(0)
+    , sleeping(0)
+{
+}
+
+void SleepTiles::init(uint32_t particleRows, uint32_t particleCols) {
+    rows = particleRows;
+    cols = particleCols;
+    tilesX = (cols + SLEEP_TILE_SIZE - 1) / SLEEP_TILE_SIZE;
+    tilesY = (rows + SLEEP_TILE_SIZE - 1) / SLEEP_TILE_SIZE;
+
+    asleep.assign(static_cast<size_t>(tilesX) * tilesY, 0);
+    quietSteps.assign(asleep.size(), 0);
+    tileSpeeds.assign(asleep.size(), 0.0f);
+    sleeping = 0;
+
+    savedInvMass.assign(static_cast<size_t>(rows) * cols, 0.0f);
+    particleAsleep.assign(savedInvMass.size(), 0);
+    buildRuns();
+}
+
+bool SleepTiles::update(ParticleStore& particles, int steps, float dt) {
+    // Fastest particle of each awake tile over the last step
+    const float invDt = 1.0f / dt;
+    for (size_t tile = 0; tile < asleep.size(); ++tile) {
+        if (asleep[tile]) {
+            tileSpeeds[tile] = 0.0f;
+            continue;
+        }
+
+        float maxSq = 0.0f;
+        forEachParticle(tile, [&](uint32_t i) {
+            glm::vec3 d = particles.positions[i] - particles.prevPositions[i];
+            maxSq = std::max(maxSq, glm::dot(d, d));
+        });
+        tileSpeeds[tile] = std::sqrt(maxSq) * invDt;
+    }
+
+    bool changed = false;
+    for (size_t tile = 0; tile < asleep.size(); ++tile) {
+        if (asleep[tile]) {
+            if (neighbourMoving(tile)) {
+                wake(particles, tile);
+                changed = true;
+            }
+            continue;
+        }
+
+        quietSteps[tile] = tileSpeeds[tile] < sleepSpeed ? quietSteps[tile] + steps : 0;
+        if (quietSteps[tile] >= sleepSteps) {
+            sleep(particles, tile);
+            changed = true;
+        }
+    }
+
+    if (changed) {
+        buildRuns();
+    }
+    return changed;
+}
+
+bool SleepTiles::wakeAll(ParticleStore& particles) {
+    if (sleeping == 0) return false;
+
+    for (size_t tile = 0; tile < asleep.size(); ++tile) {
+        if (asleep[tile]) {
+            wake(particles, tile);
+        }
+    }
+    buildRuns();
+    return true;
+}
+
+void SleepTiles::sleep(ParticleStore& particles, size_t tile) {
+    forEachParticle(tile, [&](uint32_t i) {
+        savedInvMass[i] = particles.invMass[i];
+        particles.invMass[i] = 0.0f;
+        particles.prevPositions[i] = particles.positions[i];
+        particleAsleep[i] = 1;
+    });
+    asleep[tile] = 1;
+    ++sleeping;
+}
+
+void SleepTiles::wake(ParticleStore& particles, size_t tile) {
+    forEachParticle(tile, [&](uint32_t i) {
+        particles.invMass[i] = savedInvMass[i];
+        particleAsleep[i] = 0;
+    });
+    asleep[tile] = 0;
+    quietSteps[tile] = 0;
+    --sleeping;
+}
+
+bool SleepTiles::neighbourMoving(size_t tile) const {
+    const int tx = static_cast<int>(tile % tilesX);
+    const int ty = static_cast<int>(tile / tilesX);
+
+    for (int dy = -1; dy <= 1; ++dy) {
+        for (int dx = -1; dx <= 1; ++dx) {
+            int x = tx + dx;
+            int y = ty + dy;
+            if (x < 0 || y < 0 || x >= static_cast<int>(tilesX) || y >= static_cast<int>(tilesY)) continue;
+
+            if (tileSpeeds[static_cast<size_t>(y) * tilesX + x] > wakeSpeed) return true;
+        }
+    }
+    return false;
+}
+
+void SleepTiles::buildRuns() {
+    // Walk each particle row tile by tile; an awake stretch that carries on
+    // where the previous one ended, even across rows, extends it
+    runs.clear();
+    for (uint32_t y = 0; y < rows; ++y) {
+        const size_t tileRow = static_cast<size_t>(y / SLEEP_TILE_SIZE) * tilesX;
+        for (uint32_t tx = 0; tx < tilesX; ++tx) {
+            if (asleep[tileRow + tx]) continue;
+
+            uint32_t begin = y * cols + tx * SLEEP_TILE_SIZE;
+            uint32_t end = y * cols + std::min((tx + 1) * SLEEP_TILE_SIZE, cols);
+            if (!runs.empty() && runs.back().end == begin) {
+                runs.back().end = end;
+            }
+            else {
+                runs.push_back({ begin, end });
+            }
+        }
+    }
+}
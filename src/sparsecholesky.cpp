@@ -0,0 +1,170 @@
+#include "sparsecholesky.hpp"
+#include <cmath>
+
+SparseCholesky::SparseCholesky() {
+}
+
+bool SparseCholesky::factor(std::span<const uint32_t> rowOffsets, std::span<const uint32_t> columns,
+    std::span<const double> values, std::span<const uint32_t> pivotOrder) {
+    const size_t n = pivotOrder.size();
+    order.assign(pivotOrder.begin(), pivotOrder.end());
+    columnOffsets.clear();
+    factorRows.clear();
+    factorValues.clear();
+
+    std::vector<uint32_t> pivotOf(n);
+    for (size_t k = 0; k < n; ++k) {
+        pivotOf[order[k]] = static_cast<uint32_t>(k);
+    }
+
+    // Upper triangle of P A P^T: entry (i, k) with i <= k goes to column k
+    upperOffsets.assign(n + 1, 0);
+    for (size_t row = 0; row < n; ++row) {
+        for (uint32_t p = rowOffsets[row]; p < rowOffsets[row + 1]; ++p) {
+            uint32_t i = pivotOf[row];
+            uint32_t k = pivotOf[columns[p]];
+            if (i <= k) ++upperOffsets[k + 1];
+        }
+    }
+    for (size_t k = 0; k < n; ++k) {
+        upperOffsets[k + 1] += upperOffsets[k];
+    }
+    upperRows.resize(upperOffsets[n]);
+    upperValues.resize(upperOffsets[n]);
+    std::vector<uint32_t> next(upperOffsets.begin(), upperOffsets.end() - 1);
+    for (size_t row = 0; row < n; ++row) {
+        for (uint32_t p = rowOffsets[row]; p < rowOffsets[row + 1]; ++p) {
+            uint32_t i = pivotOf[row];
+            uint32_t k = pivotOf[columns[p]];
+            if (i > k) continue;
+
+            uint32_t slot = next[k]++;
+            upperRows[slot] = i;
+            upperValues[slot] = values[p];
+        }
+    }
+
+    // Elimination tree, with path compression through `ancestor`
+    parent.assign(n, -1);
+    ancestor.assign(n, -1);
+    for (size_t k = 0; k < n; ++k) {
+        for (uint32_t p = upperOffsets[k]; p < upperOffsets[k + 1]; ++p) {
+            int32_t i = static_cast<int32_t>(upperRows[p]);
+            while (i != -1 && i < static_cast<int32_t>(k)) {
+                int32_t inext = ancestor[i];
+                ancestor[i] = static_cast<int32_t>(k);
+                if (inext == -1) parent[i] = static_cast<int32_t>(k);
+                i = inext;
+            }
+        }
+    }
+
+    // Row k of L is the part of the tree reached from column k's entries,
+    // so counting the reaches gives the column counts
+    marks.assign(n, -1);
+    stack.resize(n);
+    std::vector<uint32_t> counts(n, 1);
+    for (size_t k = 0; k < n; ++k) {
+        for (size_t top = reach(static_cast<uint32_t>(k)); top < n; ++top) {
+            ++counts[stack[top]];
+        }
+    }
+
+    std::vector<uint32_t> offsets(n + 1, 0);
+    for (size_t k = 0; k < n; ++k) {
+        offsets[k + 1] = offsets[k] + counts[k];
+    }
+    factorRows.resize(offsets[n]);
+    factorValues.resize(offsets[n]);
+
+    // Up-looking: row k of L is a sparse triangular solve against the
+    // columns before it, then each column grows by one entry
+    std::vector<double> x(n, 0.0);
+    next.assign(offsets.begin(), offsets.end() - 1);
+    marks.assign(n, -1);
+    for (size_t k = 0; k < n; ++k) {
+        size_t top = reach(static_cast<uint32_t>(k));
+        x[k] = 0.0;
+        for (uint32_t p = upperOffsets[k]; p < upperOffsets[k + 1]; ++p) {
+            x[upperRows[p]] += upperValues[p];
+        }
+        double diagonal = x[k];
+        x[k] = 0.0;
+
+        for (; top < n; ++top) {
+            uint32_t i = stack[top];
+            double lki = x[i] / factorValues[offsets[i]];
+            x[i] = 0.0;
+            for (uint32_t p = offsets[i] + 1; p < next[i]; ++p) {
+                x[factorRows[p]] -= factorValues[p] * lki;
+            }
+            diagonal -= lki * lki;
+
+            uint32_t slot = next[i]++;
+            factorRows[slot] = static_cast<uint32_t>(k);
+            factorValues[slot] = lki;
+        }
+
+        if (diagonal <= 0.0) {
+            factorRows.clear();
+            factorValues.clear();
+            return false;
+        }
+        uint32_t slot = next[k]++;
+        factorRows[slot] = static_cast<uint32_t>(k);
+        factorValues[slot] = std::sqrt(diagonal);
+    }
+
+    columnOffsets = std::move(offsets);
+    return true;
+}
+
+size_t SparseCholesky::reach(uint32_t k) {
+    // Walks up the tree from each entry above the diagonal of column k,
+    // stopping at nodes already visited for this k. The paths are pushed
+    // so that stack[top, n) is in topological order.
+    const size_t n = parent.size();
+    size_t top = n;
+    marks[k] = static_cast<int32_t>(k);
+    for (uint32_t p = upperOffsets[k]; p < upperOffsets[k + 1]; ++p) {
+        int32_t i = static_cast<int32_t>(upperRows[p]);
+        if (i >= static_cast<int32_t>(k)) continue;
+
+        size_t length = 0;
+        for (; marks[i] != static_cast<int32_t>(k); i = parent[i]) {
+            stack[length++] = static_cast<uint32_t>(i);
+            marks[i] = static_cast<int32_t>(k);
+        }
+        while (length > 0) {
+            stack[--top] = stack[--length];
+        }
+    }
+    return top;
+}
+
+void SparseCholesky::solve(std::span<double> b, std::span<double> work) const {
+    const size_t n = order.size();
+    for (size_t k = 0; k < n; ++k) {
+        work[k] = b[order[k]];
+    }
+
+    // L y = P b
+    for (size_t j = 0; j < n; ++j) {
+        work[j] /= factorValues[columnOffsets[j]];
+        for (uint32_t p = columnOffsets[j] + 1; p < columnOffsets[j + 1]; ++p) {
+            work[factorRows[p]] -= factorValues[p] * work[j];
+        }
+    }
+
+    // L^T z = y
+    for (size_t j = n; j-- > 0;) {
+        for (uint32_t p = columnOffsets[j] + 1; p < columnOffsets[j + 1]; ++p) {
+            work[j] -= factorValues[p] * work[factorRows[p]];
+        }
+        work[j] /= factorValues[columnOffsets[j]];
+    }
+
+    for (size_t k = 0; k < n; ++k) {
+        b[order[k]] = work[k];
+    }
+}
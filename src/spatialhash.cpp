@@ -0,0 +1,148 @@
+#include "spatialhash.hpp"
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <limits>
+
+SpatialHash::SpatialHash()
+    : cellSize(1.0f)
+    , invCellSize(1.0f)
+    , slotMask(0)
+    , boundsMin(0.0f)
+    , boundsMax(0.0f)
+{
+}
+
+void SpatialHash::clear() {
+    slotStart.clear();
+    entries.clear();
+    particleSlots.clear();
+}
+
+void SpatialHash::build(const glm::vec3* positions, size_t count, float size) {
+    fill(positions, count, size, [](size_t k) { return static_cast<uint32_t>(k); });
+}
+
+void SpatialHash::build(const glm::vec3* positions, std::span<const uint32_t> indices, float size) {
+    fill(positions, indices.size(), size, [indices](size_t k) { return indices[k]; });
+}
+
+template<typename IndexFunction>
+void SpatialHash::fill(const glm::vec3* positions, size_t count, float size, IndexFunction&& index) {
+    if (count == 0) {
+        clear();
+        return;
+    }
+
+    cellSize = size;
+    invCellSize = 1.0f / size;
+
+    // Twice as many slots as particles keeps shared slots rare
+    uint32_t slots = std::bit_ceil(static_cast<uint32_t>(count * 2));
+    slotMask = slots - 1;
+
+    slotStart.assign(slots + 1, 0);
+    particleSlots.resize(count);
+    entries.resize(count);
+
+    boundsMin = glm::vec3(std::numeric_limits<float>::max());
+    boundsMax = glm::vec3(std::numeric_limits<float>::lowest());
+
+    for (size_t k = 0; k < count; ++k) {
+        const glm::vec3& p = positions[index(k)];
+        uint32_t slot = slotOf(cellOf(p));
+        particleSlots[k] = slot;
+        ++slotStart[slot];
+        boundsMin = glm::min(boundsMin, p);
+        boundsMax = glm::max(boundsMax, p);
+    }
+
+    // Running totals give each slot its end; filling backwards walks every
+    // slot's start back into place and keeps particles in list order
+    for (uint32_t s = 1; s < slots; ++s) {
+        slotStart[s] += slotStart[s - 1];
+    }
+    for (size_t k = count; k-- > 0;) {
+        entries[--slotStart[particleSlots[k]]] = index(k);
+    }
+    slotStart[slots] = static_cast<uint32_t>(count);
+}
+
+int SpatialHash::closestToRay(const glm::vec3* positions, const glm::vec3& origin, const glm::vec3& dir, float maxDistance) const {
+    if (entries.empty()) return -1;
+
+    // Clip the ray to the particle bounds, grown by the search distance
+    glm::vec3 lo = boundsMin - glm::vec3(maxDistance);
+    glm::vec3 hi = boundsMax + glm::vec3(maxDistance);
+    float tEnter = 0.0f;
+    float tExit = std::numeric_limits<float>::max();
+
+    for (int axis = 0; axis < 3; ++axis) {
+        if (std::abs(dir[axis]) < 1e-8f) {
+            if (origin[axis] < lo[axis] || origin[axis] > hi[axis]) return -1;
+            continue;
+        }
+        float t0 = (lo[axis] - origin[axis]) / dir[axis];
+        float t1 = (hi[axis] - origin[axis]) / dir[axis];
+        tEnter = std::max(tEnter, std::min(t0, t1));
+        tExit = std::min(tExit, std::max(t0, t1));
+    }
+    if (tEnter > tExit) return -1;
+
+    // 3D DDA through the cells the ray crosses, collecting every slot within
+    // reach of them
+    glm::vec3 start = origin + dir * tEnter;
+    glm::ivec3 cell = cellOf(start);
+    glm::ivec3 step(0);
+    glm::vec3 tMax(std::numeric_limits<float>::max());
+    glm::vec3 tDelta(std::numeric_limits<float>::max());
+
+    for (int axis = 0; axis < 3; ++axis) {
+        if (std::abs(dir[axis]) < 1e-8f) continue;
+
+        step[axis] = dir[axis] > 0.0f ? 1 : -1;
+        float boundary = (cell[axis] + (step[axis] > 0 ? 1 : 0)) * cellSize;
+        tMax[axis] = tEnter + (boundary - start[axis]) / dir[axis];
+        tDelta[axis] = cellSize / std::abs(dir[axis]);
+    }
+
+    const int reach = static_cast<int>(std::ceil(maxDistance * invCellSize));
+    std::vector<uint32_t> slots;
+
+    for (float t = tEnter; t <= tExit;) {
+        for (int z = -reach; z <= reach; ++z) {
+            for (int y = -reach; y <= reach; ++y) {
+                for (int x = -reach; x <= reach; ++x) {
+                    slots.push_back(slotOf(cell + glm::ivec3(x, y, z)));
+                }
+            }
+        }
+
+        int axis = tMax.x < tMax.y ? (tMax.x < tMax.z ? 0 : 2) : (tMax.y < tMax.z ? 1 : 2);
+        t = tMax[axis];
+        cell[axis] += step[axis];
+        tMax[axis] += tDelta[axis];
+    }
+
+    std::sort(slots.begin(), slots.end());
+    slots.erase(std::unique(slots.begin(), slots.end()), slots.end());
+
+    float minDistSq = maxDistance * maxDistance;
+    int closest = -1;
+
+    for (uint32_t slot : slots) {
+        for (uint32_t k = slotStart[slot]; k < slotStart[slot + 1]; ++k) {
+            uint32_t i = entries[k];
+            glm::vec3 toParticle = positions[i] - origin;
+            glm::vec3 offset = toParticle - glm::dot(toParticle, dir) * dir;
+            float distSq = glm::dot(offset, offset);
+
+            if (distSq < minDistSq || (distSq == minDistSq && closest >= 0 && static_cast<int>(i) < closest)) {
+                minDistSq = distSq;
+                closest = static_cast<int>(i);
+            }
+        }
+    }
+
+    return closest;
+}
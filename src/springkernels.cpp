@@ -0,0 +1,284 @@
+#include <SDL3/SDL.h>
+#include <algorithm>
+#include <cmath>
+#include <glm/glm.hpp>
+#include "springkernels.hpp"
+
+static_assert(sizeof(glm::vec3) == 3 * sizeof(float), "Kernels treat glm::vec3 arrays as packed xyz triplets");
+
+namespace SpringKernels
+{
+    ISA detectISA() {
+#if SPRING_KERNELS_X86
+        if (SDL_HasAVX2()) {
+            return ISA::AVX2;
+        }
+        if (SDL_HasSSE41()) {
+            return ISA::SSE41;
+        }
+#endif
+        return ISA::SCALAR;
+    }
+
+    const char* isaName(ISA isa) {
+        switch (isa) {
+        case ISA::AVX2:
+            return "AVX2";
+        case ISA::SSE41:
+            return "SSE4.1";
+        default:
+            return "Scalar";
+        }
+    }
+
+    void applyForces(ISA isa, const SpringKernelArgs& args) {
+        switch (isa) {
+#if SPRING_KERNELS_X86
+        case ISA::AVX2:
+            applyForcesAVX2(args);
+            break;
+        case ISA::SSE41:
+            applyForcesSSE41(args);
+            break;
+#endif
+        default:
+            applyForcesScalar(args);
+            break;
+        }
+    }
+
+    void satisfyConstraints(ISA isa, const SpringKernelArgs& args) {
+        switch (isa) {
+#if SPRING_KERNELS_X86
+        case ISA::AVX2:
+            satisfyConstraintsAVX2(args);
+            break;
+        case ISA::SSE41:
+            satisfyConstraintsSSE41(args);
+            break;
+#endif
+        default:
+            satisfyConstraintsScalar(args);
+            break;
+        }
+    }
+
+    void applyForcesScalar(const SpringKernelArgs& args) {
+        glm::vec3* positions = reinterpret_cast<glm::vec3*>(args.positions);
+        const glm::vec3* prevPositions = reinterpret_cast<const glm::vec3*>(args.prevPositions);
+        glm::vec3* forces = reinterpret_cast<glm::vec3*>(args.forces);
+
+        for (size_t i = 0; i < args.count; ++i) {
+            const Spring& s = args.springs[i];
+            if (!s.active) continue;
+
+            glm::vec3 delta = positions[s.p2] - positions[s.p1];
+            float currentLength = glm::length(delta);
+
+            if (currentLength == 0.0f) continue;
+
+            const SpringMaterial& mat = args.materials[static_cast<size_t>(s.type)];
+            glm::vec3 direction = delta / currentLength;
+
+            float displacement = currentLength - s.restLength;
+            float stretchRatio = currentLength * s.invRestLength;
+
+            // Apply increasingly strong force as stretch increases
+            float forceMultiplier = 1.0f;
+            if (stretchRatio > 1.1f) {
+                forceMultiplier = stretchRatio * stretchRatio * stretchRatio;
+            }
+
+            glm::vec3 springForce = mat.stiffness * displacement * forceMultiplier * direction;
+
+            // Add damping
+            glm::vec3 p1Velocity = positions[s.p1] - prevPositions[s.p1];
+            glm::vec3 p2Velocity = positions[s.p2] - prevPositions[s.p2];
+            glm::vec3 relativeVelocity = p2Velocity - p1Velocity;
+
+            float dampingMagnitude = glm::dot(relativeVelocity, direction);
+            glm::vec3 dampingForce = mat.damping * dampingMagnitude * direction;
+
+            glm::vec3 totalForce = springForce + dampingForce;
+
+            forces[s.p1] += totalForce;
+            forces[s.p2] -= totalForce;
+        }
+    }
+
+    void sampleGrid(ISA isa, const GridSampleArgs& args) {
+        switch (isa) {
+#if SPRING_KERNELS_X86
+        case ISA::AVX2:
+            sampleGridAVX2(args);
+            break;
+        case ISA::SSE41:
+            sampleGridSSE41(args);
+            break;
+#endif
+        default:
+            sampleGridScalar(args);
+            break;
+        }
+    }
+
+    void satisfyConstraintsScalar(const SpringKernelArgs& args) {
+        glm::vec3* positions = reinterpret_cast<glm::vec3*>(args.positions);
+
+        for (size_t i = 0; i < args.count; ++i) {
+            const Spring& s = args.springs[i];
+            if (!s.active) continue;
+
+            glm::vec3 delta = positions[s.p2] - positions[s.p1];
+            float currentLength = glm::length(delta);
+
+            if (currentLength == 0.0f) continue;
+
+            float maxLength = s.restLength * 1.2f;
+            if (currentLength > maxLength) {
+                float excess = currentLength - maxLength;
+                glm::vec3 direction = delta / currentLength;
+                glm::vec3 correction = direction * excess * 0.5f;
+
+                bool pinned1 = args.invMass[s.p1] == 0.0f;
+                bool pinned2 = args.invMass[s.p2] == 0.0f;
+
+                if (!pinned1 && !pinned2) {
+                    positions[s.p1] += correction;
+                    positions[s.p2] -= correction;
+                }
+                else if (pinned1 && !pinned2) {
+                    positions[s.p2] -= correction * 2.0f;
+                }
+                else if (!pinned1 && pinned2) {
+                    positions[s.p1] += correction * 2.0f;
+                }
+            }
+        }
+    }
+
+    void jacobiCorrectionsScalar(const SpringKernelArgs& args, float* corrections) {
+        const glm::vec3* positions = reinterpret_cast<const glm::vec3*>(args.positions);
+        glm::vec3* out = reinterpret_cast<glm::vec3*>(corrections);
+
+        for (size_t i = 0; i < args.count; ++i) {
+            const Spring& s = args.springs[i];
+            out[i] = glm::vec3(0.0f);
+            if (!s.active) continue;
+
+            glm::vec3 delta = positions[s.p2] - positions[s.p1];
+            float currentLength = glm::length(delta);
+
+            if (currentLength == 0.0f) continue;
+
+            float maxLength = s.restLength * 1.2f;
+            if (currentLength > maxLength) {
+                float excess = currentLength - maxLength;
+                out[i] = delta / currentLength * excess * 0.5f;
+            }
+        }
+    }
+
+    void xpbdScalar(const SpringKernelArgs& args, const XpbdParams& params, float* lambdas) {
+        glm::vec3* positions = reinterpret_cast<glm::vec3*>(args.positions);
+        const glm::vec3* prevPositions = reinterpret_cast<const glm::vec3*>(args.prevPositions);
+        const float invDt2 = 1.0f / (params.dt * params.dt);
+
+        for (size_t i = 0; i < args.count; ++i) {
+            const Spring& s = args.springs[i];
+            if (!s.active) continue;
+
+            float w1 = args.invMass[s.p1];
+            float w2 = args.invMass[s.p2];
+            float wSum = w1 + w2;
+            if (wSum == 0.0f) continue;
+
+            glm::vec3 delta = positions[s.p2] - positions[s.p1];
+            float currentLength = glm::length(delta);
+
+            if (currentLength == 0.0f) continue;
+
+            glm::vec3 direction = delta / currentLength;
+            size_t type = static_cast<size_t>(s.type);
+            float constraint = currentLength - s.restLength;
+
+            // Compliance scaled by the step, and the damping term of
+            // Macklin et al., which reads the velocity along the spring
+            float alphaTilde = params.compliance[type] * invDt2;
+            float gamma = params.compliance[type] * params.damping[type] / params.dt;
+            float rate = glm::dot(direction, (positions[s.p2] - prevPositions[s.p2]) - (positions[s.p1] - prevPositions[s.p1]));
+
+            float deltaLambda = (-constraint - alphaTilde * lambdas[i] - gamma * rate) / ((1.0f + gamma) * wSum + alphaTilde);
+            lambdas[i] += deltaLambda;
+
+            positions[s.p1] -= direction * (w1 * deltaLambda);
+            positions[s.p2] += direction * (w2 * deltaLambda);
+        }
+    }
+
+    void residualScalar(const SpringKernelArgs& args, const XpbdParams* params, const float* lambdas, float& maxViolation, float& sumSquares) {
+        const glm::vec3* positions = reinterpret_cast<const glm::vec3*>(args.positions);
+        const glm::vec3* prevPositions = reinterpret_cast<const glm::vec3*>(args.prevPositions);
+
+        for (size_t i = 0; i < args.count; ++i) {
+            const Spring& s = args.springs[i];
+            if (!s.active) continue;
+            if (args.invMass[s.p1] + args.invMass[s.p2] == 0.0f) continue;
+
+            glm::vec3 delta = positions[s.p2] - positions[s.p1];
+            float currentLength = glm::length(delta);
+
+            float violation;
+            if (params) {
+                if (currentLength == 0.0f) continue;
+
+                // The numerator of xpbdScalar's deltaLambda
+                size_t type = static_cast<size_t>(s.type);
+                glm::vec3 direction = delta / currentLength;
+                float alphaTilde = params->compliance[type] / (params->dt * params->dt);
+                float gamma = params->compliance[type] * params->damping[type] / params->dt;
+                float rate = glm::dot(direction, (positions[s.p2] - prevPositions[s.p2]) - (positions[s.p1] - prevPositions[s.p1]));
+                violation = std::abs(currentLength - s.restLength + alphaTilde * lambdas[i] + gamma * rate);
+            }
+            else {
+                violation = std::max(currentLength - s.restLength * 1.2f, 0.0f);
+            }
+
+            violation *= s.invRestLength;
+            maxViolation = std::max(maxViolation, violation);
+            sumSquares += violation * violation;
+        }
+    }
+
+    void sampleGridScalar(const GridSampleArgs& args) {
+        const glm::vec3* grid = reinterpret_cast<const glm::vec3*>(args.grid);
+        const glm::vec3* points = reinterpret_cast<const glm::vec3*>(args.points);
+        glm::vec3* out = reinterpret_cast<glm::vec3*>(args.out);
+        const glm::vec3 origin(args.origin[0], args.origin[1], args.origin[2]);
+        const uint32_t size = args.size;
+        const uint32_t mask = size - 1;
+        auto node = [size](uint32_t x, uint32_t y, uint32_t z) {
+            return (static_cast<size_t>(z) * size + y) * size + x;
+        };
+
+        for (size_t i = 0; i < args.count; ++i) {
+            const glm::vec3 g = (points[i] - origin) * args.invCellSize;
+            const glm::vec3 cell = glm::floor(g);
+            const glm::vec3 t = g - cell;
+
+            // Two's complement wraps negative cells the right way round
+            const uint32_t x0 = static_cast<uint32_t>(static_cast<int32_t>(cell.x)) & mask;
+            const uint32_t y0 = static_cast<uint32_t>(static_cast<int32_t>(cell.y)) & mask;
+            const uint32_t z0 = static_cast<uint32_t>(static_cast<int32_t>(cell.z)) & mask;
+            const uint32_t x1 = (x0 + 1) & mask;
+            const uint32_t y1 = (y0 + 1) & mask;
+            const uint32_t z1 = (z0 + 1) & mask;
+
+            const glm::vec3 x00 = glm::mix(grid[node(x0, y0, z0)], grid[node(x1, y0, z0)], t.x);
+            const glm::vec3 x10 = glm::mix(grid[node(x0, y1, z0)], grid[node(x1, y1, z0)], t.x);
+            const glm::vec3 x01 = glm::mix(grid[node(x0, y0, z1)], grid[node(x1, y0, z1)], t.x);
+            const glm::vec3 x11 = glm::mix(grid[node(x0, y1, z1)], grid[node(x1, y1, z1)], t.x);
+            out[i] = glm::mix(glm::mix(x00, x10, t.y), glm::mix(x01, x11, t.y), t.z);
+        }
+    }
+}
@@ -0,0 +1,233 @@
+#include "springkernels.hpp"
+
+#if SPRING_KERNELS_X86
+#include <immintrin.h>
+
+// Built with AVX2 enabled; only reached when the CPU reports AVX2 support.
+
+namespace SpringKernels
+{
+    void applyForcesAVX2(const SpringKernelArgs& args) {
+        const __m256 one = _mm256_set1_ps(1.0f);
+        const __m256 zero = _mm256_setzero_ps();
+        const __m256 stretchLimit = _mm256_set1_ps(1.1f);
+
+        alignas(32) int32_t idx1[8], idx2[8];
+        alignas(32) float rest[8], invRest[8], stiffness[8], damping[8];
+        alignas(32) int32_t active[8];
+        alignas(32) float fx[8], fy[8], fz[8];
+
+        for (size_t base = 0; base < args.count; base += 8) {
+            for (int lane = 0; lane < 8; ++lane) {
+                const Spring& s = args.springs[base + lane];
+                const SpringMaterial& mat = args.materials[static_cast<size_t>(s.type)];
+                idx1[lane] = static_cast<int32_t>(s.p1 * 3);
+                idx2[lane] = static_cast<int32_t>(s.p2 * 3);
+                rest[lane] = s.restLength;
+                invRest[lane] = s.invRestLength;
+                stiffness[lane] = mat.stiffness;
+                damping[lane] = mat.damping;
+                active[lane] = s.active ? -1 : 0;
+            }
+
+            __m256i i1 = _mm256_load_si256(reinterpret_cast<const __m256i*>(idx1));
+            __m256i i2 = _mm256_load_si256(reinterpret_cast<const __m256i*>(idx2));
+
+            __m256 x1 = _mm256_i32gather_ps(args.positions + 0, i1, 4);
+            __m256 y1 = _mm256_i32gather_ps(args.positions + 1, i1, 4);
+            __m256 z1 = _mm256_i32gather_ps(args.positions + 2, i1, 4);
+            __m256 x2 = _mm256_i32gather_ps(args.positions + 0, i2, 4);
+            __m256 y2 = _mm256_i32gather_ps(args.positions + 1, i2, 4);
+            __m256 z2 = _mm256_i32gather_ps(args.positions + 2, i2, 4);
+
+            __m256 dx = _mm256_sub_ps(x2, x1);
+            __m256 dy = _mm256_sub_ps(y2, y1);
+            __m256 dz = _mm256_sub_ps(z2, z1);
+
+            __m256 len = _mm256_sqrt_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)), _mm256_mul_ps(dz, dz)));
+            __m256 valid = _mm256_and_ps(
+                _mm256_castsi256_ps(_mm256_load_si256(reinterpret_cast<const __m256i*>(active))),
+                _mm256_cmp_ps(len, zero, _CMP_NEQ_OQ));
+
+            __m256 invLen = _mm256_div_ps(one, len);
+            __m256 dirX = _mm256_mul_ps(dx, invLen);
+            __m256 dirY = _mm256_mul_ps(dy, invLen);
+            __m256 dirZ = _mm256_mul_ps(dz, invLen);
+
+            // Spring force with the cubic stiffening past 10% stretch
+            __m256 displacement = _mm256_sub_ps(len, _mm256_load_ps(rest));
+            __m256 ratio = _mm256_mul_ps(len, _mm256_load_ps(invRest));
+            __m256 cube = _mm256_mul_ps(_mm256_mul_ps(ratio, ratio), ratio);
+            __m256 multiplier = _mm256_blendv_ps(one, cube, _mm256_cmp_ps(ratio, stretchLimit, _CMP_GT_OQ));
+            __m256 springMag = _mm256_mul_ps(_mm256_mul_ps(_mm256_load_ps(stiffness), displacement), multiplier);
+
+            // Damping along the spring direction
+            __m256 vx = _mm256_sub_ps(_mm256_sub_ps(x2, _mm256_i32gather_ps(args.prevPositions + 0, i2, 4)),
+                                      _mm256_sub_ps(x1, _mm256_i32gather_ps(args.prevPositions + 0, i1, 4)));
+            __m256 vy = _mm256_sub_ps(_mm256_sub_ps(y2, _mm256_i32gather_ps(args.prevPositions + 1, i2, 4)),
+                                      _mm256_sub_ps(y1, _mm256_i32gather_ps(args.prevPositions + 1, i1, 4)));
+            __m256 vz = _mm256_sub_ps(_mm256_sub_ps(z2, _mm256_i32gather_ps(args.prevPositions + 2, i2, 4)),
+                                      _mm256_sub_ps(z1, _mm256_i32gather_ps(args.prevPositions + 2, i1, 4)));
+            __m256 dampingMag = _mm256_mul_ps(_mm256_load_ps(damping),
+                _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(vx, dirX), _mm256_mul_ps(vy, dirY)), _mm256_mul_ps(vz, dirZ)));
+
+            __m256 magnitude = _mm256_add_ps(springMag, dampingMag);
+
+            // Mask after the multiply so degenerate lanes can't leak NaNs
+            _mm256_store_ps(fx, _mm256_and_ps(_mm256_mul_ps(magnitude, dirX), valid));
+            _mm256_store_ps(fy, _mm256_and_ps(_mm256_mul_ps(magnitude, dirY), valid));
+            _mm256_store_ps(fz, _mm256_and_ps(_mm256_mul_ps(magnitude, dirZ), valid));
+
+            for (int lane = 0; lane < 8; ++lane) {
+                float* f1 = args.forces + idx1[lane];
+                float* f2 = args.forces + idx2[lane];
+                f1[0] += fx[lane];
+                f1[1] += fy[lane];
+                f1[2] += fz[lane];
+                f2[0] -= fx[lane];
+                f2[1] -= fy[lane];
+                f2[2] -= fz[lane];
+            }
+        }
+    }
+
+    void satisfyConstraintsAVX2(const SpringKernelArgs& args) {
+        const __m256 one = _mm256_set1_ps(1.0f);
+        const __m256 zero = _mm256_setzero_ps();
+        const __m256 maxStretch = _mm256_set1_ps(1.2f);
+        const __m256 half = _mm256_set1_ps(0.5f);
+
+        alignas(32) int32_t idx1[8], idx2[8];
+        alignas(32) float rest[8], scale1[8], scale2[8];
+        alignas(32) int32_t active[8];
+        alignas(32) float cx[8], cy[8], cz[8];
+
+        for (size_t base = 0; base < args.count; base += 8) {
+            for (int lane = 0; lane < 8; ++lane) {
+                const Spring& s = args.springs[base + lane];
+                bool free1 = args.invMass[s.p1] != 0.0f;
+                bool free2 = args.invMass[s.p2] != 0.0f;
+                idx1[lane] = static_cast<int32_t>(s.p1 * 3);
+                idx2[lane] = static_cast<int32_t>(s.p2 * 3);
+                rest[lane] = s.restLength;
+                // A free particle takes the whole correction when its partner is pinned
+                scale1[lane] = free1 ? (free2 ? 1.0f : 2.0f) : 0.0f;
+                scale2[lane] = free2 ? (free1 ? 1.0f : 2.0f) : 0.0f;
+                active[lane] = s.active ? -1 : 0;
+            }
+
+            __m256i i1 = _mm256_load_si256(reinterpret_cast<const __m256i*>(idx1));
+            __m256i i2 = _mm256_load_si256(reinterpret_cast<const __m256i*>(idx2));
+
+            __m256 dx = _mm256_sub_ps(_mm256_i32gather_ps(args.positions + 0, i2, 4), _mm256_i32gather_ps(args.positions + 0, i1, 4));
+            __m256 dy = _mm256_sub_ps(_mm256_i32gather_ps(args.positions + 1, i2, 4), _mm256_i32gather_ps(args.positions + 1, i1, 4));
+            __m256 dz = _mm256_sub_ps(_mm256_i32gather_ps(args.positions + 2, i2, 4), _mm256_i32gather_ps(args.positions + 2, i1, 4));
+
+            __m256 len = _mm256_sqrt_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)), _mm256_mul_ps(dz, dz)));
+            __m256 maxLength = _mm256_mul_ps(_mm256_load_ps(rest), maxStretch);
+
+            __m256 mask = _mm256_and_ps(
+                _mm256_castsi256_ps(_mm256_load_si256(reinterpret_cast<const __m256i*>(active))),
+                _mm256_and_ps(_mm256_cmp_ps(len, zero, _CMP_NEQ_OQ), _mm256_cmp_ps(len, maxLength, _CMP_GT_OQ)));
+
+            // correction = direction * excess * 0.5
+            __m256 factor = _mm256_mul_ps(_mm256_mul_ps(_mm256_sub_ps(len, maxLength), half), _mm256_div_ps(one, len));
+            factor = _mm256_and_ps(factor, mask);
+
+            _mm256_store_ps(cx, _mm256_mul_ps(dx, factor));
+            _mm256_store_ps(cy, _mm256_mul_ps(dy, factor));
+            _mm256_store_ps(cz, _mm256_mul_ps(dz, factor));
+
+            // Batches are conflict free, so the scatter can't overwrite a
+            // particle another lane of this batch has read.
+            for (int lane = 0; lane < 8; ++lane) {
+                float* a = args.positions + idx1[lane];
+                float* b = args.positions + idx2[lane];
+                a[0] += cx[lane] * scale1[lane];
+                a[1] += cy[lane] * scale1[lane];
+                a[2] += cz[lane] * scale1[lane];
+                b[0] -= cx[lane] * scale2[lane];
+                b[1] -= cy[lane] * scale2[lane];
+                b[2] -= cz[lane] * scale2[lane];
+            }
+        }
+    }
+
+    void sampleGridAVX2(const GridSampleArgs& args) {
+        const __m256 one = _mm256_set1_ps(1.0f);
+        const __m256 invCellSize = _mm256_set1_ps(args.invCellSize);
+        const __m256 originX = _mm256_set1_ps(args.origin[0]);
+        const __m256 originY = _mm256_set1_ps(args.origin[1]);
+        const __m256 originZ = _mm256_set1_ps(args.origin[2]);
+        const __m256i mask = _mm256_set1_epi32(static_cast<int32_t>(args.size - 1));
+        const __m256i triplets = _mm256_setr_epi32(0, 3, 6, 9, 12, 15, 18, 21);
+        const int32_t size = static_cast<int32_t>(args.size);
+
+        alignas(32) float ox[8], oy[8], oz[8];
+
+        const size_t vectorCount = args.count - args.count % 8;
+        for (size_t base = 0; base < vectorCount; base += 8) {
+            const float* p = args.points + base * 3;
+            __m256 gx = _mm256_mul_ps(_mm256_sub_ps(_mm256_i32gather_ps(p + 0, triplets, 4), originX), invCellSize);
+            __m256 gy = _mm256_mul_ps(_mm256_sub_ps(_mm256_i32gather_ps(p + 1, triplets, 4), originY), invCellSize);
+            __m256 gz = _mm256_mul_ps(_mm256_sub_ps(_mm256_i32gather_ps(p + 2, triplets, 4), originZ), invCellSize);
+
+            __m256 cellX = _mm256_floor_ps(gx);
+            __m256 cellY = _mm256_floor_ps(gy);
+            __m256 cellZ = _mm256_floor_ps(gz);
+            __m256 tx = _mm256_sub_ps(gx, cellX);
+            __m256 ty = _mm256_sub_ps(gy, cellY);
+            __m256 tz = _mm256_sub_ps(gz, cellZ);
+
+            // Node indices times three, wrapped like the scalar lookup
+            __m256i x0 = _mm256_and_si256(_mm256_cvttps_epi32(cellX), mask);
+            __m256i y0 = _mm256_and_si256(_mm256_cvttps_epi32(cellY), mask);
+            __m256i z0 = _mm256_and_si256(_mm256_cvttps_epi32(cellZ), mask);
+            __m256i x1 = _mm256_and_si256(_mm256_add_epi32(x0, _mm256_set1_epi32(1)), mask);
+            __m256i y1 = _mm256_and_si256(_mm256_add_epi32(y0, _mm256_set1_epi32(1)), mask);
+            __m256i z1 = _mm256_and_si256(_mm256_add_epi32(z0, _mm256_set1_epi32(1)), mask);
+            x0 = _mm256_mullo_epi32(x0, _mm256_set1_epi32(3));
+            x1 = _mm256_mullo_epi32(x1, _mm256_set1_epi32(3));
+            y0 = _mm256_mullo_epi32(y0, _mm256_set1_epi32(size * 3));
+            y1 = _mm256_mullo_epi32(y1, _mm256_set1_epi32(size * 3));
+            z0 = _mm256_mullo_epi32(z0, _mm256_set1_epi32(size * size * 3));
+            z1 = _mm256_mullo_epi32(z1, _mm256_set1_epi32(size * size * 3));
+
+            // a * (1 - t) + b * t, the way glm::mix does it, so the bits match
+            auto mix = [one](__m256 a, __m256 b, __m256 t) {
+                return _mm256_add_ps(_mm256_mul_ps(a, _mm256_sub_ps(one, t)), _mm256_mul_ps(b, t));
+            };
+            auto mixX = [&](__m256i row, int c) {
+                __m256 a = _mm256_i32gather_ps(args.grid + c, _mm256_add_epi32(row, x0), 4);
+                __m256 b = _mm256_i32gather_ps(args.grid + c, _mm256_add_epi32(row, x1), 4);
+                return mix(a, b, tx);
+            };
+
+            const __m256i r00 = _mm256_add_epi32(y0, z0);
+            const __m256i r10 = _mm256_add_epi32(y1, z0);
+            const __m256i r01 = _mm256_add_epi32(y0, z1);
+            const __m256i r11 = _mm256_add_epi32(y1, z1);
+            float* components[3] = { ox, oy, oz };
+            for (int c = 0; c < 3; ++c) {
+                __m256 near = mix(mixX(r00, c), mixX(r10, c), ty);
+                __m256 far = mix(mixX(r01, c), mixX(r11, c), ty);
+                _mm256_store_ps(components[c], mix(near, far, tz));
+            }
+
+            float* out = args.out + base * 3;
+            for (int lane = 0; lane < 8; ++lane) {
+                out[lane * 3 + 0] = ox[lane];
+                out[lane * 3 + 1] = oy[lane];
+                out[lane * 3 + 2] = oz[lane];
+            }
+        }
+
+        GridSampleArgs rest = args;
+        rest.points += vectorCount * 3;
+        rest.out += vectorCount * 3;
+        rest.count -= vectorCount;
+        sampleGridScalar(rest);
+    }
+}
+
+#endif
@@ -0,0 +1,205 @@
+#include "springkernels.hpp"
+
+#if SPRING_KERNELS_X86
+#include <smmintrin.h>
+
+// Built with SSE4.1 enabled; only reached when the CPU reports SSE4.1 support.
+// There is no gather before AVX2, so lanes are filled with scalar loads.
+
+namespace SpringKernels
+{
+    void applyForcesSSE41(const SpringKernelArgs& args) {
+        const __m128 one = _mm_set1_ps(1.0f);
+        const __m128 zero = _mm_setzero_ps();
+        const __m128 stretchLimit = _mm_set1_ps(1.1f);
+
+        alignas(16) int32_t idx1[4], idx2[4];
+        alignas(16) float x1[4], y1[4], z1[4], x2[4], y2[4], z2[4];
+        alignas(16) float vx[4], vy[4], vz[4];
+        alignas(16) float rest[4], invRest[4], stiffness[4], damping[4];
+        alignas(16) int32_t active[4];
+        alignas(16) float fx[4], fy[4], fz[4];
+
+        for (size_t base = 0; base < args.count; base += 4) {
+            for (int lane = 0; lane < 4; ++lane) {
+                const Spring& s = args.springs[base + lane];
+                const SpringMaterial& mat = args.materials[static_cast<size_t>(s.type)];
+                const float* a = args.positions + s.p1 * 3;
+                const float* b = args.positions + s.p2 * 3;
+                const float* pa = args.prevPositions + s.p1 * 3;
+                const float* pb = args.prevPositions + s.p2 * 3;
+                idx1[lane] = static_cast<int32_t>(s.p1 * 3);
+                idx2[lane] = static_cast<int32_t>(s.p2 * 3);
+                x1[lane] = a[0]; y1[lane] = a[1]; z1[lane] = a[2];
+                x2[lane] = b[0]; y2[lane] = b[1]; z2[lane] = b[2];
+                vx[lane] = (b[0] - pb[0]) - (a[0] - pa[0]);
+                vy[lane] = (b[1] - pb[1]) - (a[1] - pa[1]);
+                vz[lane] = (b[2] - pb[2]) - (a[2] - pa[2]);
+                rest[lane] = s.restLength;
+                invRest[lane] = s.invRestLength;
+                stiffness[lane] = mat.stiffness;
+                damping[lane] = mat.damping;
+                active[lane] = s.active ? -1 : 0;
+            }
+
+            __m128 dx = _mm_sub_ps(_mm_load_ps(x2), _mm_load_ps(x1));
+            __m128 dy = _mm_sub_ps(_mm_load_ps(y2), _mm_load_ps(y1));
+            __m128 dz = _mm_sub_ps(_mm_load_ps(z2), _mm_load_ps(z1));
+
+            __m128 len = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz)));
+            __m128 valid = _mm_and_ps(
+                _mm_castsi128_ps(_mm_load_si128(reinterpret_cast<const __m128i*>(active))),
+                _mm_cmpneq_ps(len, zero));
+
+            __m128 invLen = _mm_div_ps(one, len);
+            __m128 dirX = _mm_mul_ps(dx, invLen);
+            __m128 dirY = _mm_mul_ps(dy, invLen);
+            __m128 dirZ = _mm_mul_ps(dz, invLen);
+
+            // Spring force with the cubic stiffening past 10% stretch
+            __m128 displacement = _mm_sub_ps(len, _mm_load_ps(rest));
+            __m128 ratio = _mm_mul_ps(len, _mm_load_ps(invRest));
+            __m128 cube = _mm_mul_ps(_mm_mul_ps(ratio, ratio), ratio);
+            __m128 multiplier = _mm_blendv_ps(one, cube, _mm_cmpgt_ps(ratio, stretchLimit));
+            __m128 springMag = _mm_mul_ps(_mm_mul_ps(_mm_load_ps(stiffness), displacement), multiplier);
+
+            // Damping along the spring direction
+            __m128 dampingMag = _mm_mul_ps(_mm_load_ps(damping),
+                _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_load_ps(vx), dirX), _mm_mul_ps(_mm_load_ps(vy), dirY)), _mm_mul_ps(_mm_load_ps(vz), dirZ)));
+
+            __m128 magnitude = _mm_add_ps(springMag, dampingMag);
+
+            // Mask after the multiply so degenerate lanes can't leak NaNs
+            _mm_store_ps(fx, _mm_and_ps(_mm_mul_ps(magnitude, dirX), valid));
+            _mm_store_ps(fy, _mm_and_ps(_mm_mul_ps(magnitude, dirY), valid));
+            _mm_store_ps(fz, _mm_and_ps(_mm_mul_ps(magnitude, dirZ), valid));
+
+            for (int lane = 0; lane < 4; ++lane) {
+                float* f1 = args.forces + idx1[lane];
+                float* f2 = args.forces + idx2[lane];
+                f1[0] += fx[lane];
+                f1[1] += fy[lane];
+                f1[2] += fz[lane];
+                f2[0] -= fx[lane];
+                f2[1] -= fy[lane];
+                f2[2] -= fz[lane];
+            }
+        }
+    }
+
+    void satisfyConstraintsSSE41(const SpringKernelArgs& args) {
+        const __m128 one = _mm_set1_ps(1.0f);
+        const __m128 zero = _mm_setzero_ps();
+        const __m128 maxStretch = _mm_set1_ps(1.2f);
+        const __m128 half = _mm_set1_ps(0.5f);
+
+        alignas(16) int32_t idx1[4], idx2[4];
+        alignas(16) float dxs[4], dys[4], dzs[4];
+        alignas(16) float rest[4], scale1[4], scale2[4];
+        alignas(16) int32_t active[4];
+        alignas(16) float cx[4], cy[4], cz[4];
+
+        for (size_t base = 0; base < args.count; base += 4) {
+            for (int lane = 0; lane < 4; ++lane) {
+                const Spring& s = args.springs[base + lane];
+                const float* a = args.positions + s.p1 * 3;
+                const float* b = args.positions + s.p2 * 3;
+                bool free1 = args.invMass[s.p1] != 0.0f;
+                bool free2 = args.invMass[s.p2] != 0.0f;
+                idx1[lane] = static_cast<int32_t>(s.p1 * 3);
+                idx2[lane] = static_cast<int32_t>(s.p2 * 3);
+                dxs[lane] = b[0] - a[0];
+                dys[lane] = b[1] - a[1];
+                dzs[lane] = b[2] - a[2];
+                rest[lane] = s.restLength;
+                // A free particle takes the whole correction when its partner is pinned
+                scale1[lane] = free1 ? (free2 ? 1.0f : 2.0f) : 0.0f;
+                scale2[lane] = free2 ? (free1 ? 1.0f : 2.0f) : 0.0f;
+                active[lane] = s.active ? -1 : 0;
+            }
+
+            __m128 dx = _mm_load_ps(dxs);
+            __m128 dy = _mm_load_ps(dys);
+            __m128 dz = _mm_load_ps(dzs);
+
+            __m128 len = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz)));
+            __m128 maxLength = _mm_mul_ps(_mm_load_ps(rest), maxStretch);
+
+            __m128 mask = _mm_and_ps(
+                _mm_castsi128_ps(_mm_load_si128(reinterpret_cast<const __m128i*>(active))),
+                _mm_and_ps(_mm_cmpneq_ps(len, zero), _mm_cmpgt_ps(len, maxLength)));
+
+            // correction = direction * excess * 0.5
+            __m128 factor = _mm_mul_ps(_mm_mul_ps(_mm_sub_ps(len, maxLength), half), _mm_div_ps(one, len));
+            factor = _mm_and_ps(factor, mask);
+
+            _mm_store_ps(cx, _mm_mul_ps(dx, factor));
+            _mm_store_ps(cy, _mm_mul_ps(dy, factor));
+            _mm_store_ps(cz, _mm_mul_ps(dz, factor));
+
+            // Batches are conflict free, so the scatter can't overwrite a
+            // particle another lane of this batch has read.
+            for (int lane = 0; lane < 4; ++lane) {
+                float* a = args.positions + idx1[lane];
+                float* b = args.positions + idx2[lane];
+                a[0] += cx[lane] * scale1[lane];
+                a[1] += cy[lane] * scale1[lane];
+                a[2] += cz[lane] * scale1[lane];
+                b[0] -= cx[lane] * scale2[lane];
+                b[1] -= cy[lane] * scale2[lane];
+                b[2] -= cz[lane] * scale2[lane];
+            }
+        }
+    }
+
+    void sampleGridSSE41(const GridSampleArgs& args) {
+        // One point at a time with its xyz in three lanes, which beats four
+        // points a lane each when every corner has to be loaded by hand
+        const __m128 one = _mm_set1_ps(1.0f);
+        const __m128 origin = _mm_setr_ps(args.origin[0], args.origin[1], args.origin[2], 0.0f);
+        const __m128 invCellSize = _mm_set1_ps(args.invCellSize);
+        const __m128i mask = _mm_set1_epi32(static_cast<int32_t>(args.size - 1));
+        const __m128i strides = _mm_setr_epi32(3, static_cast<int32_t>(args.size * 3), static_cast<int32_t>(args.size * args.size * 3), 0);
+
+        alignas(16) int32_t lo[4], hi[4];
+
+        // Three floats without reading past them
+        auto load3 = [](const float* p) {
+            return _mm_movelh_ps(_mm_castpd_ps(_mm_load_sd(reinterpret_cast<const double*>(p))), _mm_load_ss(p + 2));
+        };
+        // a * (1 - t) + b * t, the way glm::mix does it, so the bits match
+        auto mix = [one](__m128 a, __m128 b, __m128 t) {
+            return _mm_add_ps(_mm_mul_ps(a, _mm_sub_ps(one, t)), _mm_mul_ps(b, t));
+        };
+
+        for (size_t i = 0; i < args.count; ++i) {
+            __m128 g = _mm_mul_ps(_mm_sub_ps(load3(args.points + i * 3), origin), invCellSize);
+            __m128 cell = _mm_floor_ps(g);
+            __m128 t = _mm_sub_ps(g, cell);
+
+            // Offsets of the nodes either side along each axis, wrapped like
+            // the scalar lookup
+            __m128i c0 = _mm_and_si128(_mm_cvttps_epi32(cell), mask);
+            __m128i c1 = _mm_and_si128(_mm_add_epi32(c0, _mm_set1_epi32(1)), mask);
+            _mm_store_si128(reinterpret_cast<__m128i*>(lo), _mm_mullo_epi32(c0, strides));
+            _mm_store_si128(reinterpret_cast<__m128i*>(hi), _mm_mullo_epi32(c1, strides));
+
+            const __m128 tx = _mm_shuffle_ps(t, t, _MM_SHUFFLE(0, 0, 0, 0));
+            const __m128 ty = _mm_shuffle_ps(t, t, _MM_SHUFFLE(1, 1, 1, 1));
+            const __m128 tz = _mm_shuffle_ps(t, t, _MM_SHUFFLE(2, 2, 2, 2));
+            auto mixX = [&](int32_t row) {
+                return mix(load3(args.grid + row + lo[0]), load3(args.grid + row + hi[0]), tx);
+            };
+
+            __m128 near = mix(mixX(lo[1] + lo[2]), mixX(hi[1] + lo[2]), ty);
+            __m128 far = mix(mixX(lo[1] + hi[2]), mixX(hi[1] + hi[2]), ty);
+            __m128 v = mix(near, far, tz);
+
+            float* out = args.out + i * 3;
+            _mm_store_sd(reinterpret_cast<double*>(out), _mm_castps_pd(v));
+            _mm_store_ss(out + 2, _mm_movehl_ps(v, v));
+        }
+    }
+}
+
+#endif
@@ -1,70 +1,457 @@
 #include "springs.hpp"
+#include <algorithm>
+#include <bit>
+#include <cmath>
 
-Spring::Spring(Particle* particleA, Particle* particleB, float k, float dampingCoeff)
-    : p1(particleA)
-    , p2(particleB)
-    , stiffness(k)
-    , damping(dampingCoeff)
+SpringBuffer::SpringBuffer()
+    : jacobiRelaxation(1.5f)
+    , tail{ 0, 0, 0 }
+    , live(0)
+    , maxRestLength(0.0f)
+    , isa(SpringKernels::detectISA())
 {
-    restLength = glm::length(p1->position - p2->position);
 }
 
-void Spring::applyForces() {
-    glm::vec3 delta = p2->position - p1->position;
-    float currentLength = glm::length(delta);
+void SpringBuffer::clear() {
+    springs.clear();
+    colors.clear();
+    tail = { 0, 0, 0 };
+    live = 0;
+    maxRestLength = 0.0f;
+    particleSpringOffsets.clear();
+    particleSpringCounts.clear();
+    particleSprings.clear();
+    jacobiCorrections.clear();
+    lambdas.clear();
+    residualPartials.clear();
+    sleepingChunks.clear();
+}
+
+void SpringBuffer::reserve(size_t count) {
+    springs.reserve(count);
+}
+
+uint32_t SpringBuffer::add(const ParticleStore& particles, uint32_t particleA, uint32_t particleB, SPRINGTYPE type) {
+    float restLength = glm::length(particles.positions[particleA] - particles.positions[particleB]);
+
+    Spring spring;
+    spring.p1 = particleA;
+    spring.p2 = particleB;
+    spring.restLength = restLength;
+    spring.invRestLength = restLength > 0.0f ? 1.0f / restLength : 0.0f;
+    spring.type = type;
+    spring.active = 1;
+    springs.push_back(spring);
+    maxRestLength = std::max(maxRestLength, restLength);
+
+    // New springs join the serial tail, in front of any torn ones there
+    size_t index = springs.size() - 1;
+    if (index != tail.end) {
+        std::swap(springs[index], springs[tail.end]);
+        index = tail.end;
+    }
+    ++tail.end;
+    tail.capacityEnd = springs.size();
+    ++live;
+    lambdas.resize(springs.size(), 0.0f);
+
+    return static_cast<uint32_t>(index);
+}
+
+void SpringBuffer::buildColors(size_t particleCount) {
+    // Each particle keeps a bit per color already used by one of its springs,
+    // so a spring takes the lowest color free at both of its ends.
+    constexpr int MAX_COLORS = 64;
+
+    std::vector<uint64_t> usedColors(particleCount, 0);
+    std::vector<uint8_t> springColor(springs.size());
+    std::vector<size_t> colorSizes(MAX_COLORS + 1, 0);
+
+    for (size_t i = 0; i < springs.size(); ++i) {
+        const Spring& s = springs[i];
+        uint64_t available = ~(usedColors[s.p1] | usedColors[s.p2]);
+
+        int color = MAX_COLORS;
+        if (available != 0 && s.p1 != s.p2) {
+            color = std::countr_zero(available);
+            usedColors[s.p1] |= uint64_t(1) << color;
+            usedColors[s.p2] |= uint64_t(1) << color;
+        }
+
+        springColor[i] = static_cast<uint8_t>(color);
+        ++colorSizes[color];
+    }
+
+    // Counting sort by color, keeping the original order inside a color
+    std::vector<size_t> offsets(MAX_COLORS + 1, 0);
+    colors.clear();
+    size_t offset = 0;
+    for (int color = 0; color <= MAX_COLORS; ++color) {
+        offsets[color] = offset;
+        if (color < MAX_COLORS && colorSizes[color] > 0) {
+            colors.push_back({ offset, offset + colorSizes[color], offset + colorSizes[color] });
+        }
+        offset += colorSizes[color];
+    }
+    tail = { springs.size() - colorSizes[MAX_COLORS], springs.size(), springs.size() };
+
+    AlignedVector<Spring> sorted(springs.size());
+    for (size_t i = 0; i < springs.size(); ++i) {
+        sorted[offsets[springColor[i]]++] = springs[i];
+    }
+    springs.swap(sorted);
+
+    // Springs that were already torn go behind the live ones of their color
+    auto partition = [&](SpringColor& range) {
+        auto first = springs.begin() + range.begin;
+        auto last = springs.begin() + range.capacityEnd;
+        range.end = std::stable_partition(first, last, [](const Spring& s) { return s.active != 0; }) - springs.begin();
+    };
+    live = 0;
+    for (SpringColor& color : colors) {
+        partition(color);
+        live += color.liveCount();
+    }
+    partition(tail);
+    live += tail.liveCount();
+
+    buildParticleSprings(particleCount);
+}
 
-    if (currentLength == 0.0f) return;
+void SpringBuffer::buildParticleSprings(size_t particleCount) {
+    // Room for every spring, torn or not, so activateAll never has to grow it
+    particleSpringOffsets.assign(particleCount + 1, 0);
+    for (const Spring& s : springs) {
+        ++particleSpringOffsets[s.p1 + 1];
+        ++particleSpringOffsets[s.p2 + 1];
+    }
+    for (size_t i = 0; i < particleCount; ++i) {
+        particleSpringOffsets[i + 1] += particleSpringOffsets[i];
+    }
+
+    // Springs go in by index, so every particle sees them in the same order
+    particleSpringCounts.assign(particleCount, 0);
+    particleSprings.resize(particleSpringOffsets.back());
+    forEachLive([&](const Spring& s) {
+        uint32_t index = static_cast<uint32_t>(&s - springs.data());
+        particleSprings[particleSpringOffsets[s.p1] + particleSpringCounts[s.p1]++] = index;
+        particleSprings[particleSpringOffsets[s.p2] + particleSpringCounts[s.p2]++] = index;
+    });
+
+    jacobiCorrections.assign(springs.size(), glm::vec3(0.0f));
+    lambdas.assign(springs.size(), 0.0f);
+}
+
+void SpringBuffer::unlinkParticleSpring(uint32_t particle, uint32_t spring) {
+    uint32_t* first = particleSprings.data() + particleSpringOffsets[particle];
+    uint32_t* last = first + particleSpringCounts[particle];
+
+    // Shift the rest down rather than swapping, to keep the gather order stable
+    uint32_t* slot = std::find(first, last, spring);
+    if (slot != last) {
+        std::copy(slot + 1, last, slot);
+        --particleSpringCounts[particle];
+    }
+}
+
+void SpringBuffer::relinkParticleSpring(uint32_t particle, uint32_t from, uint32_t to) {
+    uint32_t* first = particleSprings.data() + particleSpringOffsets[particle];
+    uint32_t* last = first + particleSpringCounts[particle];
+    std::replace(first, last, from, to);
+}
+
+std::span<const uint32_t> SpringBuffer::springsOf(uint32_t particle) const {
+    if (particle >= particleSpringCounts.size()) return {};
+    return { particleSprings.data() + particleSpringOffsets[particle], particleSpringCounts[particle] };
+}
 
-    glm::vec3 direction = delta / currentLength;
+SpringColor& SpringBuffer::rangeOf(size_t i) {
+    if (i >= tail.begin) return tail;
 
-    float displacement = currentLength - restLength;
-    float stretchRatio = currentLength / restLength;
+    auto after = std::upper_bound(colors.begin(), colors.end(), i,
+        [](size_t index, const SpringColor& color) { return index < color.begin; });
+    return *(after - 1);
+}
+
+void SpringBuffer::tear(SpringColor& range, size_t i) {
+    size_t last = --range.end;
+    --live;
+
+    springs[i].active = 0;
+    if (!particleSpringCounts.empty()) {
+        unlinkParticleSpring(springs[i].p1, static_cast<uint32_t>(i));
+        unlinkParticleSpring(springs[i].p2, static_cast<uint32_t>(i));
+    }
+
+    if (i != last) {
+        if (!particleSpringCounts.empty()) {
+            relinkParticleSpring(springs[last].p1, static_cast<uint32_t>(last), static_cast<uint32_t>(i));
+            relinkParticleSpring(springs[last].p2, static_cast<uint32_t>(last), static_cast<uint32_t>(i));
+        }
+        std::swap(springs[i], springs[last]);
+    }
+}
+
+void SpringBuffer::setMaterial(SPRINGTYPE type, float k, float dampingCoeff) {
+    materials[static_cast<size_t>(type)] = { k, dampingCoeff };
+}
+
+void SpringBuffer::activateAll() {
+    for (auto& s : springs) {
+        s.active = 1;
+    }
 
-    // Apply increasingly strong force as stretch increases
-    float forceMultiplier = 1.0f;
-    if (stretchRatio > 1.1f) {
+    for (SpringColor& color : colors) {
+        color.end = color.capacityEnd;
+    }
+    tail.end = tail.capacityEnd;
+    live = springs.size();
 
-        forceMultiplier = pow(stretchRatio, 3.0f);
+    if (!particleSpringCounts.empty()) {
+        buildParticleSprings(particleSpringCounts.size());
     }
+}
 
-    glm::vec3 springForce = stiffness * displacement * forceMultiplier * direction;
+SpringKernelArgs SpringBuffer::makeArgs(ParticleStore& particles, size_t first, size_t count) const {
+    SpringKernelArgs args;
+    args.springs = springs.data() + first;
+    args.count = count;
+    args.materials = materials.data();
+    args.positions = &particles.positions.data()->x;
+    args.prevPositions = &particles.prevPositions.data()->x;
+    args.forces = &particles.forces.data()->x;
+    args.invMass = particles.invMass.data();
+    return args;
+}
 
-    // Add damping
-    glm::vec3 p1Velocity = p1->position - p1->prevPosition;
-    glm::vec3 p2Velocity = p2->position - p2->prevPosition;
-    glm::vec3 relativeVelocity = p2Velocity - p1Velocity;
+void SpringBuffer::applyForcesRange(ParticleStore& particles, size_t first, size_t count) const {
+    size_t vectorCount = count - count % SPRING_BATCH_WIDTH;
+    SpringKernels::applyForces(isa, makeArgs(particles, first, vectorCount));
+    SpringKernels::applyForcesScalar(makeArgs(particles, first + vectorCount, count - vectorCount));
+}
 
-    float dampingMagnitude = glm::dot(relativeVelocity, direction);
-    glm::vec3 dampingForce = damping * dampingMagnitude * direction;
+void SpringBuffer::satisfyConstraintsRange(ParticleStore& particles, size_t first, size_t count) const {
+    size_t vectorCount = count - count % SPRING_BATCH_WIDTH;
+    SpringKernels::satisfyConstraints(isa, makeArgs(particles, first, vectorCount));
+    SpringKernels::satisfyConstraintsScalar(makeArgs(particles, first + vectorCount, count - vectorCount));
+}
 
-    glm::vec3 totalForce = springForce + dampingForce;
+TaskGraph::TaskId SpringBuffer::addForceTasks(TaskGraph& graph, ParticleStore& particles, TaskGraph::TaskId after) const {
+    size_t chunk = 0;
+    for (const SpringColor& color : colors) {
+        TaskGraph::TaskId task = graph.addParallelFor(color.liveCount(), SPRING_PARALLEL_GRAIN,
+            [this, &particles, first = color.begin, chunk](size_t begin, size_t end) {
+                if (chunkAsleep(chunk + begin / SPRING_PARALLEL_GRAIN)) return;
+                applyForcesRange(particles, first + begin, end - begin);
+            });
+        graph.precede(after, task);
+        after = task;
+        chunk += chunksOf(color);
+    }
 
-    p1->addForce(totalForce);
-    p2->addForce(-totalForce);
+    TaskGraph::TaskId serial = graph.add([this, &particles] {
+        SpringKernels::applyForcesScalar(makeArgs(particles, tail.begin, tail.liveCount()));
+    });
+    graph.precede(after, serial);
+    return serial;
 }
 
-void Spring::satisfyConstraint() {
-    
-    glm::vec3 delta = p2->position - p1->position;
-    float currentLength = glm::length(delta);
+TaskGraph::TaskId SpringBuffer::addConstraintTasks(TaskGraph& graph, ParticleStore& particles, TaskGraph::TaskId after) const {
+    size_t chunk = 0;
+    for (const SpringColor& color : colors) {
+        TaskGraph::TaskId task = graph.addParallelFor(color.liveCount(), SPRING_PARALLEL_GRAIN,
+            [this, &particles, first = color.begin, chunk](size_t begin, size_t end) {
+                if (chunkAsleep(chunk + begin / SPRING_PARALLEL_GRAIN)) return;
+                satisfyConstraintsRange(particles, first + begin, end - begin);
+            });
+        graph.precede(after, task);
+        after = task;
+        chunk += chunksOf(color);
+    }
 
-    if (currentLength == 0.0f) return;
+    TaskGraph::TaskId serial = graph.add([this, &particles] {
+        SpringKernels::satisfyConstraintsScalar(makeArgs(particles, tail.begin, tail.liveCount()));
+    });
+    graph.precede(after, serial);
+    return serial;
+}
+
+void SpringBuffer::applyJacobiRange(ParticleStore& particles, size_t begin, size_t end) const {
+    glm::vec3* positions = particles.positions.data();
+    const float* invMass = particles.invMass.data();
+    const float relaxation = jacobiRelaxation;
+
+    for (size_t i = begin; i < end; ++i) {
+        if (invMass[i] == 0.0f) continue;
 
-    float maxLength = restLength * 1.2f;
-    if (currentLength > maxLength) {
-        float excess = currentLength - maxLength;
-        glm::vec3 direction = delta / currentLength;
-        glm::vec3 correction = direction * excess * 0.5f;
+        glm::vec3 sum(0.0f);
+        int constraints = 0;
 
-        if (!p1->pinned && !p2->pinned) {
-            p1->position += correction;
-            p2->position -= correction;
+        const uint32_t first = particleSpringOffsets[i];
+        for (uint32_t k = first; k < first + particleSpringCounts[i]; ++k) {
+            uint32_t index = particleSprings[k];
+            const glm::vec3& correction = jacobiCorrections[index];
+            if (correction == glm::vec3(0.0f)) continue;
+
+            // Same split as satisfyConstraintsScalar: a spring to a pinned
+            // particle pushes the free end the whole way
+            const Spring& s = springs[index];
+            bool isFirst = s.p1 == i;
+            uint32_t other = isFirst ? s.p2 : s.p1;
+            float scale = invMass[other] == 0.0f ? 2.0f : 1.0f;
+
+            sum += isFirst ? correction * scale : correction * -scale;
+            ++constraints;
         }
-        else if (p1->pinned && !p2->pinned) {
-            p2->position -= correction * 2.0f;
+
+        if (constraints > 0) {
+            positions[i] += sum * (relaxation / static_cast<float>(constraints));
         }
-        else if (!p1->pinned && p2->pinned) {
-            p1->position += correction * 2.0f;
+    }
+}
+
+TaskGraph::TaskId SpringBuffer::addJacobiTasks(TaskGraph& graph, ParticleStore& particles, TaskGraph::TaskId after) {
+    TaskGraph::TaskId apply = graph.addParallelFor(particles.size(), JACOBI_PARTICLE_GRAIN,
+        [this, &particles](size_t begin, size_t end) {
+            applyJacobiRange(particles, begin, end);
+        });
+
+    // Colors don't matter here, they're just where the live springs are.
+    // A sleeping chunk's corrections are never read: all its particles are
+    // asleep and skip the gather.
+    size_t chunk = 0;
+    auto addCorrections = [&](const SpringColor& range) {
+        TaskGraph::TaskId corrections = graph.addParallelFor(range.liveCount(), SPRING_PARALLEL_GRAIN,
+            [this, &particles, first = range.begin, chunk](size_t begin, size_t end) {
+                if (chunkAsleep(chunk + begin / SPRING_PARALLEL_GRAIN)) return;
+                SpringKernels::jacobiCorrectionsScalar(makeArgs(particles, first + begin, end - begin), &jacobiCorrections[first + begin].x);
+            });
+        graph.precede(after, corrections);
+        graph.precede(corrections, apply);
+        chunk += chunksOf(range);
+    };
+
+    for (const SpringColor& color : colors) {
+        addCorrections(color);
+    }
+    addCorrections(tail);
+
+    return apply;
+}
+
+XpbdParams SpringBuffer::xpbdParams(float dt, std::array<float, static_cast<size_t>(SPRINGTYPE::LAST)>& damping) const {
+    for (size_t type = 0; type < damping.size(); ++type) {
+        damping[type] = materials[type].damping;
+    }
+    return XpbdParams{ compliance.data(), damping.data(), dt };
+}
+
+void SpringBuffer::xpbdRange(ParticleStore& particles, size_t first, size_t count, float dt) {
+    std::array<float, static_cast<size_t>(SPRINGTYPE::LAST)> damping;
+    SpringKernels::xpbdScalar(makeArgs(particles, first, count), xpbdParams(dt, damping), lambdas.data() + first);
+}
+
+TaskGraph::TaskId SpringBuffer::addXpbdResetTasks(TaskGraph& graph, TaskGraph::TaskId after) {
+    TaskGraph::TaskId reset = graph.addParallelFor(lambdas.size(), SPRING_PARALLEL_GRAIN, [this](size_t begin, size_t end) {
+        std::fill(lambdas.begin() + begin, lambdas.begin() + end, 0.0f);
+    });
+    graph.precede(after, reset);
+    return reset;
+}
+
+TaskGraph::TaskId SpringBuffer::addXpbdTasks(TaskGraph& graph, ParticleStore& particles, float dt, TaskGraph::TaskId after) {
+    size_t chunk = 0;
+    for (const SpringColor& color : colors) {
+        TaskGraph::TaskId task = graph.addParallelFor(color.liveCount(), SPRING_PARALLEL_GRAIN,
+            [this, &particles, dt, first = color.begin, chunk](size_t begin, size_t end) {
+                if (chunkAsleep(chunk + begin / SPRING_PARALLEL_GRAIN)) return;
+                xpbdRange(particles, first + begin, end - begin, dt);
+            });
+        graph.precede(after, task);
+        after = task;
+        chunk += chunksOf(color);
+    }
+
+    TaskGraph::TaskId serial = graph.add([this, &particles, dt] {
+        xpbdRange(particles, tail.begin, tail.liveCount(), dt);
+    });
+    graph.precede(after, serial);
+    return serial;
+}
+
+void SpringBuffer::residualRange(ParticleStore& particles, size_t first, size_t count, bool xpbd, float dt, ResidualPartial& partial) const {
+    std::array<float, static_cast<size_t>(SPRINGTYPE::LAST)> damping;
+    XpbdParams params = xpbdParams(dt, damping);
+
+    partial.maxViolation = 0.0f;
+    partial.sumSquares = 0.0f;
+    SpringKernels::residualScalar(makeArgs(particles, first, count), xpbd ? &params : nullptr,
+        lambdas.data() + first, partial.maxViolation, partial.sumSquares);
+}
+
+TaskGraph::TaskId SpringBuffer::addResidualTasks(TaskGraph& graph, ParticleStore& particles, bool xpbd, float dt, TaskGraph::TaskId after) {
+    // One slot per chunk, numbered like chunkAsleep's; the tail gets the last
+    size_t slots = 1;
+    for (const SpringColor& color : colors) {
+        slots += chunksOf(color);
+    }
+    residualPartials.assign(slots, ResidualPartial{});
+
+    // Nothing is written, so every chunk can run at once
+    TaskGraph::TaskId serial = graph.add([this, &particles, xpbd, dt] {
+        residualRange(particles, tail.begin, tail.liveCount(), xpbd, dt, residualPartials.back());
+    });
+    graph.precede(after, serial);
+
+    size_t slot = 0;
+    for (const SpringColor& color : colors) {
+        TaskGraph::TaskId task = graph.addParallelFor(color.liveCount(), SPRING_PARALLEL_GRAIN,
+            [this, &particles, xpbd, dt, first = color.begin, slot](size_t begin, size_t end) {
+                ResidualPartial& partial = residualPartials[slot + begin / SPRING_PARALLEL_GRAIN];
+                if (chunkAsleep(slot + begin / SPRING_PARALLEL_GRAIN)) {
+                    partial = ResidualPartial{};
+                    return;
+                }
+                residualRange(particles, first + begin, end - begin, xpbd, dt, partial);
+            });
+        graph.precede(after, task);
+        graph.precede(task, serial);
+        slot += chunksOf(color);
+    }
+
+    return serial;
+}
+
+SpringResidual SpringBuffer::residual() const {
+    SpringResidual result{ 0.0f, 0.0f };
+    float sumSquares = 0.0f;
+    for (const ResidualPartial& partial : residualPartials) {
+        result.max = std::max(result.max, partial.maxViolation);
+        sumSquares += partial.sumSquares;
+    }
+    if (live > 0) {
+        result.rms = std::sqrt(sumSquares / static_cast<float>(live));
+    }
+    return result;
+}
+
+void SpringBuffer::setSleeping(std::span<const uint8_t> particleAsleep) {
+    sleepingChunks.clear();
+    if (particleAsleep.empty()) return;
+
+    // Same chunks the tasks split each color into
+    auto addChunks = [&](const SpringColor& range) {
+        for (size_t begin = range.begin; begin < range.end; begin += SPRING_PARALLEL_GRAIN) {
+            size_t end = std::min(begin + SPRING_PARALLEL_GRAIN, range.end);
+            bool asleep = std::all_of(springs.begin() + begin, springs.begin() + end, [&](const Spring& s) {
+                return particleAsleep[s.p1] && particleAsleep[s.p2];
+            });
+            sleepingChunks.push_back(asleep ? 1 : 0);
         }
+    };
+
+    for (const SpringColor& color : colors) {
+        addChunks(color);
     }
-}
\ No newline at end of file
+    addChunks(tail);
+}
@@ -0,0 +1,220 @@
+#include "windfield.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    // Brings the RMS of the blended swirls to about 1, measured over many
+    // seeds. A finer octave of noise would need a finer grid than the
+    // lookups can afford.
+    constexpr float CURL_NORMALIZATION = 0.85f;
+
+    // Gusts of the mean flow come this often, per second
+    constexpr float GUST_FREQUENCY = 0.25f;
+
+    // Integer hash of a lattice point; the same on every platform, unlike
+    // the standard library's distributions
+    uint32_t hashLattice(int32_t x, int32_t y, int32_t z, int32_t w, uint32_t seed) {
+        uint32_t h = seed * 0x9E3779B9u;
+        h ^= static_cast<uint32_t>(x) * 0x85EBCA6Bu;
+        h ^= static_cast<uint32_t>(y) * 0xC2B2AE35u;
+        h ^= static_cast<uint32_t>(z) * 0x27D4EB2Fu;
+        h ^= static_cast<uint32_t>(w) * 0x165667B1u;
+        h ^= h >> 15;
+        h *= 0x2C1B3C6Du;
+        h ^= h >> 12;
+        h *= 0x297A2D39u;
+        h ^= h >> 15;
+        return h;
+    }
+
+    float fade(float t) {
+        return t * t * t * (t * (t * 6.0f - 15.0f) + 10.0f);
+    }
+
+    // Perlin's gradient noise over the lattice of one time slice, in about
+    // [-1, 1]. The lattice repeats every `period` cells; p is never negative.
+    float gradientNoise(const glm::vec3& p, uint32_t period, int32_t slice, uint32_t seed) {
+        static const glm::vec3 gradients[12] = {
+            { 1, 1, 0 }, { -1, 1, 0 }, { 1, -1, 0 }, { -1, -1, 0 },
+            { 1, 0, 1 }, { -1, 0, 1 }, { 1, 0, -1 }, { -1, 0, -1 },
+            { 0, 1, 1 }, { 0, -1, 1 }, { 0, 1, -1 }, { 0, -1, -1 }
+        };
+
+        const glm::vec3 cell = glm::floor(p);
+        const glm::vec3 f = p - cell;
+        const uint32_t x = static_cast<uint32_t>(cell.x);
+        const uint32_t y = static_cast<uint32_t>(cell.y);
+        const uint32_t z = static_cast<uint32_t>(cell.z);
+
+        float corners[8];
+        for (uint32_t c = 0; c < 8; ++c) {
+            const uint32_t cx = c & 1;
+            const uint32_t cy = (c >> 1) & 1;
+            const uint32_t cz = c >> 2;
+            const uint32_t h = hashLattice(static_cast<int32_t>((x + cx) % period), static_cast<int32_t>((y + cy) % period),
+                static_cast<int32_t>((z + cz) % period), slice, seed);
+            corners[c] = glm::dot(gradients[h % 12], f - glm::vec3(static_cast<float>(cx), static_cast<float>(cy), static_cast<float>(cz)));
+        }
+
+        const float u = fade(f.x);
+        const float v = fade(f.y);
+        const float w = fade(f.z);
+        const float y0 = glm::mix(glm::mix(corners[0], corners[1], u), glm::mix(corners[2], corners[3], u), v);
+        const float y1 = glm::mix(glm::mix(corners[4], corners[5], u), glm::mix(corners[6], corners[7], u), v);
+        return glm::mix(y0, y1, w);
+    }
+
+    // One dimensional gradient noise over time, in about [-1, 1]
+    float timeNoise(float t, uint32_t seed) {
+        const float cell = std::floor(t);
+        const float f = t - cell;
+        const int32_t i = static_cast<int32_t>(cell);
+        auto slope = [seed](int32_t at) {
+            return static_cast<float>(hashLattice(at, 0, 0, -1, seed) & 0xFFFF) / 32767.5f - 1.0f;
+        };
+        return 2.0f * glm::mix(slope(i) * f, slope(i + 1) * (f - 1.0f), fade(f));
+    }
+}
+
+WindField::WindField()
+    : seed(1)
+    , direction(1.0f, 0.0f, 0.0f)
+    , meanSpeed(8.0f)
+    , gustiness(0.5f)
+    , turbulence(3.0f)
+    , scale(4.0f)
+    , evolution(0.2f)
+    , isa(SpringKernels::detectISA())
+    , meanVelocity(0.0f)
+    , drift(0.0f)
+    , invCellSize(1.0f)
+    , slice(0)
+    , sliceBlend(0.0f)
+    , bakedSlice(INVALID_SLICE)
+    , bakeNext(false)
+    , bakeBoth(false)
+    , current(0)
+    , potential(NODE_COUNT)
+    , velocity(NODE_COUNT)
+{
+    swirls[0].resize(NODE_COUNT);
+    swirls[1].resize(NODE_COUNT);
+}
+
+void WindField::advance(float time) {
+    const float gust = timeNoise(time * GUST_FREQUENCY, seed) + 0.5f * timeNoise(time * GUST_FREQUENCY * 2.0f, seed + 1);
+    meanVelocity = direction * (meanSpeed * std::max(1.0f + gustiness * gust, 0.0f));
+
+    // The swirls ride along at the average speed, so they don't jump about
+    // as the gusts come and go
+    drift = direction * (meanSpeed * time);
+    invCellSize = static_cast<float>(WIND_GRID_SIZE) / (scale * static_cast<float>(WIND_NOISE_CELLS));
+
+    const float phase = time * evolution;
+    const float cell = std::floor(phase);
+    slice = static_cast<int32_t>(cell);
+    sliceBlend = fade(phase - cell);
+
+    // Moving on by one pattern keeps the next one that's already baked
+    if (slice == bakedSlice) {
+        bakeNext = false;
+        bakeBoth = false;
+        return;
+    }
+    if (bakedSlice != INVALID_SLICE && slice == bakedSlice + 1) {
+        current = 1 - current;
+        bakeBoth = false;
+    }
+    else {
+        bakeBoth = true;
+    }
+    bakedSlice = slice;
+    bakeNext = true;
+}
+
+TaskGraph::TaskId WindField::addUpdateTasks(TaskGraph& graph, TaskGraph::TaskId after) {
+    // Both patterns share the potential, so they're baked one after the
+    // other, one z slab per chunk. Steps that bake nothing skip through.
+    TaskGraph::TaskId last = after;
+    for (int pattern = 0; pattern < 2; ++pattern) {
+        TaskGraph::TaskId potentials = graph.addParallelFor(WIND_GRID_SIZE, 1, [this, pattern](size_t begin, size_t end) {
+            if (pattern == 0 ? !bakeBoth : !bakeNext) return;
+            computePotential(slice + pattern, static_cast<uint32_t>(begin), static_cast<uint32_t>(end));
+        });
+        graph.precede(last, potentials);
+
+        // The curl needs the slabs either side
+        TaskGraph::TaskId baked = graph.addParallelFor(WIND_GRID_SIZE, 1, [this, pattern](size_t begin, size_t end) {
+            if (pattern == 0 ? !bakeBoth : !bakeNext) return;
+            computeSwirls(swirls[pattern == 0 ? current : 1 - current], static_cast<uint32_t>(begin), static_cast<uint32_t>(end));
+        });
+        graph.precede(potentials, baked);
+        last = baked;
+    }
+
+    TaskGraph::TaskId mixed = graph.addParallelFor(WIND_GRID_SIZE, 1, [this](size_t begin, size_t end) {
+        mixVelocities(static_cast<uint32_t>(begin), static_cast<uint32_t>(end));
+    });
+    graph.precede(last, mixed);
+    return mixed;
+}
+
+void WindField::sample(const glm::vec3* points, size_t count, glm::vec3* out) const {
+    GridSampleArgs args;
+    args.grid = reinterpret_cast<const float*>(velocity.data());
+    args.size = WIND_GRID_SIZE;
+    args.origin[0] = drift.x;
+    args.origin[1] = drift.y;
+    args.origin[2] = drift.z;
+    args.invCellSize = invCellSize;
+    args.points = reinterpret_cast<const float*>(points);
+    args.count = count;
+    args.out = reinterpret_cast<float*>(out);
+    SpringKernels::sampleGrid(isa, args);
+}
+
+void WindField::computePotential(int32_t pattern, uint32_t z0, uint32_t z1) {
+    constexpr float nodeSpacing = static_cast<float>(WIND_NOISE_CELLS) / static_cast<float>(WIND_GRID_SIZE);
+    for (uint32_t z = z0; z < z1; ++z) {
+        for (uint32_t y = 0; y < WIND_GRID_SIZE; ++y) {
+            for (uint32_t x = 0; x < WIND_GRID_SIZE; ++x) {
+                const glm::vec3 q = glm::vec3(static_cast<float>(x), static_cast<float>(y), static_cast<float>(z)) * nodeSpacing;
+
+                // Each component is its own noise
+                glm::vec3 psi;
+                for (int c = 0; c < 3; ++c) {
+                    const uint32_t componentSeed = seed * 3u + static_cast<uint32_t>(c) * 0x51ED27u;
+                    psi[c] = gradientNoise(q, WIND_NOISE_CELLS, pattern, componentSeed);
+                }
+                potential[node(x, y, z)] = psi;
+            }
+        }
+    }
+}
+
+void WindField::computeSwirls(AlignedVector<glm::vec3>& out, uint32_t z0, uint32_t z1) const {
+    // Central differences, wrapping around the tile, in noise cells
+    constexpr uint32_t mask = WIND_GRID_SIZE - 1;
+    constexpr float invSpan = static_cast<float>(WIND_GRID_SIZE) / (2.0f * static_cast<float>(WIND_NOISE_CELLS));
+    for (uint32_t z = z0; z < z1; ++z) {
+        for (uint32_t y = 0; y < WIND_GRID_SIZE; ++y) {
+            for (uint32_t x = 0; x < WIND_GRID_SIZE; ++x) {
+                const glm::vec3 dx = (potential[node((x + 1) & mask, y, z)] - potential[node((x - 1) & mask, y, z)]) * invSpan;
+                const glm::vec3 dy = (potential[node(x, (y + 1) & mask, z)] - potential[node(x, (y - 1) & mask, z)]) * invSpan;
+                const glm::vec3 dz = (potential[node(x, y, (z + 1) & mask)] - potential[node(x, y, (z - 1) & mask)]) * invSpan;
+                out[node(x, y, z)] = CURL_NORMALIZATION * glm::vec3(dy.z - dz.y, dz.x - dx.z, dx.y - dy.x);
+            }
+        }
+    }
+}
+
+void WindField::mixVelocities(uint32_t z0, uint32_t z1) {
+    const glm::vec3* now = swirls[current].data();
+    const glm::vec3* next = swirls[1 - current].data();
+    const size_t begin = static_cast<size_t>(z0) * WIND_GRID_SIZE * WIND_GRID_SIZE;
+    const size_t end = static_cast<size_t>(z1) * WIND_GRID_SIZE * WIND_GRID_SIZE;
+    for (size_t i = begin; i < end; ++i) {
+        velocity[i] = meanVelocity + turbulence * glm::mix(now[i], next[i], sliceBlend);
+    }
+}